@@ -0,0 +1,209 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <sstream>
+
+#include "analyse.h"
+#include "threads.h"
+
+namespace
+{
+    bool number(const std::string &s, long lo, long hi, long &v)
+    {
+        char *end = nullptr;
+        v = std::strtol(s.c_str(), &end, 10);
+        return !s.empty() && end && *end == '\0' && v >= lo && v <= hi;
+    }
+
+    void json_string(std::ostream &os, const std::string &s)
+    {
+        os << '"';
+        for (unsigned char c : s)
+        {
+            if (c == '"' || c == '\\')
+                os << '\\' << char(c);
+            else if (c < 0x20)
+            {
+                static const char hex[] = "0123456789abcdef";
+                os << "\\u00" << hex[c >> 4] << hex[c & 15];
+            }
+            else
+                os << char(c);
+        }
+        os << '"';
+    }
+}
+
+bool Analyse::parse_line(std::string_view line, Record &rec)
+{
+    std::istringstream ss{std::string(line)};
+    std::string fields[4];
+    for (auto &f : fields)
+        if (!(ss >> f))
+            return false;
+    rec.fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+    rec.id.clear();
+
+    // FEN move clocks, else EPD operations up to the end of the line
+    std::string rest;
+    std::getline(ss, rest);
+    std::istringstream clocks(rest);
+    long half, full;
+    std::string h, f;
+    if (clocks >> h >> f && number(h, 0, 10000, half) && number(f, 1, 10000, full))
+    {
+        rec.fen += " " + h + " " + f;
+        return true;
+    }
+    rec.fen += " 0 1";
+
+    const size_t id = rest.find("id ");
+    if (id != std::string::npos)
+    {
+        const size_t open = rest.find('"', id);
+        const size_t close = (open == std::string::npos ? open : rest.find('"', open + 1));
+        if (close != std::string::npos)
+            rec.id = rest.substr(open + 1, close - open - 1);
+    }
+    return true;
+}
+
+bool Analyse::EpdFile::open(const std::string &path)
+{
+    std::error_code ec;
+    const auto bytes = std::filesystem::file_size(path, ec);
+    if (ec)
+        return false;
+    Memory::release(map_);
+    size_ = size_t(bytes);
+    offset_ = count_ = 0;
+    if (!size_)
+        return true;
+    map_ = Memory::map_file(path, 0, size_);
+    return map_.ptr != nullptr;
+}
+
+bool Analyse::EpdFile::next(size_t &index, std::string_view &line)
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    const char *data = static_cast<const char *>(map_.ptr);
+    while (offset_ < size_)
+    {
+        size_t end = offset_;
+        while (end < size_ && data[end] != '\n')
+            ++end;
+        std::string_view l(data + offset_, end - offset_);
+        offset_ = end + 1;
+
+        if (!l.empty() && l.back() == '\r')
+            l.remove_suffix(1);
+        const size_t first = l.find_first_not_of(" \t");
+        if (first == std::string_view::npos || l[first] == '#')
+            continue;
+        line = l.substr(first);
+        index = count_++;
+        return true;
+    }
+    return false;
+}
+
+std::string Analyse::to_json(const Result &r)
+{
+    std::ostringstream os;
+    os << "{\"index\":" << r.index << ",\"fen\":";
+    json_string(os, r.rec.fen);
+    if (!r.rec.id.empty())
+    {
+        os << ",\"id\":";
+        json_string(os, r.rec.id);
+    }
+    if (!r.ok)
+    {
+        os << ",\"error\":\"invalid position\"}";
+        return os.str();
+    }
+    os << ",\"bestmove\":";
+    json_string(os, r.best);
+    os << ",\"score\":" << r.score << ",\"depth\":" << r.depth << ",\"nodes\":" << r.nodes << ",\"pv\":[";
+    for (size_t i = 0; i < r.pv.size(); ++i)
+    {
+        os << (i ? "," : "");
+        json_string(os, r.pv[i]);
+    }
+    os << "],\"ms\":" << uint64(r.ms) << "}";
+    return os.str();
+}
+
+void Analyse::OrderedOutput::write(size_t index, std::string line)
+{
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [&] { return index < next_ + MAX_PENDING; });
+    pending_.emplace(index, std::move(line));
+    if (index != next_)
+        return;
+    for (auto it = pending_.begin(); it != pending_.end() && it->first == next_; it = pending_.erase(it), ++next_)
+        os_ << it->second << '\n';
+    os_.flush();
+    cv_.notify_all();
+}
+
+size_t Analyse::OrderedOutput::written() const
+{
+    std::lock_guard<std::mutex> lock(mtx_);
+    return next_;
+}
+
+Analyse::Summary Analyse::run(const Options &opt, const SearcherFactory &make_searcher, std::ostream &out,
+                              std::ostream &log)
+{
+    Summary summary;
+    EpdFile file;
+    if (!file.open(opt.epd))
+    {
+        log << "could not open " << opt.epd << std::endl;
+        return summary;
+    }
+
+    OrderedOutput output(out);
+    std::atomic<size_t> failed{0};
+    std::atomic<uint64> nodes{0};
+    const unsigned int threads = std::max(opt.threads, 1u);
+
+    const auto start = std::chrono::steady_clock::now();
+    ThreadPool<WorkerThread> pool;
+    pool.init(int(threads));
+    TaskGroup group;
+    for (unsigned int t = 0; t < threads; ++t)
+        pool.enqueue(group, [&, t] {
+            const Searcher search = make_searcher(t, opt);
+            size_t index;
+            std::string_view line;
+            while (file.next(index, line))
+            {
+                Result r;
+                r.index = index;
+                if (parse_line(line, r.rec) && search(r.rec, r))
+                {
+                    r.ok = true;
+                    nodes += r.nodes;
+                }
+                else
+                {
+                    r.rec.fen = std::string(line);
+                    ++failed;
+                }
+                output.write(index, to_json(r));
+            }
+        });
+    pool.wait(group);
+
+    summary.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    summary.positions = output.written();
+    summary.failed = failed;
+    summary.nodes = nodes;
+    log << "analysed " << summary.positions << " positions (" << summary.failed << " invalid) in " << uint64(summary.ms)
+        << " ms with " << threads << " threads: " << uint64(summary.per_second()) << " positions/s, " << summary.nodes
+        << " nodes" << std::endl;
+    return summary;
+}
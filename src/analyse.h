@@ -0,0 +1,140 @@
+#pragma once
+
+#ifndef ANALYSE_H_
+#define ANALYSE_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "memory.h"
+#include "types.h"
+
+namespace Analyse {
+
+    // Per position; the search stops at whichever limit comes first. nodes is
+    // checked between iterations, so an iteration that starts below it finishes.
+    struct Limits
+    {
+        int depth = 0;
+        uint64 nodes = 0;
+        int movetime = 0; // ms
+    };
+
+    struct Options
+    {
+        std::string epd;
+        unsigned int threads = 1;
+        size_t hash_mb = 16; // split evenly between the workers
+        bool clear_hash = false; // else the table is only aged between positions
+        Limits limits;
+
+        size_t worker_hash_mb() const { return std::max<size_t>(hash_mb / std::max(threads, 1u), 1); }
+    };
+
+    // One position: the FEN (EPD lines get "0 1" clocks) and the EPD id, if any
+    struct Record
+    {
+        std::string fen;
+        std::string id;
+    };
+
+    // Accepts FEN lines and EPD lines with operations ("bm e4; id \"x\";")
+    bool parse_line(std::string_view line, Record &rec);
+
+    // Lines of a memory-mapped EPD/FEN file, handed out in order to any number of
+    // threads; blank lines and lines starting with '#' are skipped. Pages are read
+    // in as the cursor reaches them, the file is never copied.
+    class EpdFile
+    {
+    public:
+        ~EpdFile() { Memory::release(map_); }
+
+        bool open(const std::string &path);
+
+        // Next line and its 0-based index among the positions; false at the end
+        bool next(size_t &index, std::string_view &line);
+
+    private:
+        Memory::Block map_;
+        size_t size_ = 0;
+        size_t offset_ = 0;
+        size_t count_ = 0;
+        std::mutex mtx_;
+    };
+
+    struct Result
+    {
+        size_t index = 0;
+        Record rec;
+        bool ok = false; // false for a line that is not a position
+        std::string best;
+        int score = 0;
+        int depth = 0;
+        uint64 nodes = 0;
+        std::vector<std::string> pv;
+        double ms = 0.0;
+    };
+
+    // One JSON object, no trailing newline
+    std::string to_json(const Result &r);
+
+    // Writes lines in index order whatever order they are finished in. A worker
+    // running too far ahead of the oldest unfinished position waits, which bounds
+    // the lines held back.
+    class OrderedOutput
+    {
+    public:
+        static constexpr size_t MAX_PENDING = 4096;
+
+        explicit OrderedOutput(std::ostream &os) : os_(os) {}
+
+        void write(size_t index, std::string line);
+        size_t written() const;
+
+    private:
+        std::ostream &os_;
+        std::map<size_t, std::string> pending_;
+        size_t next_ = 0;
+        mutable std::mutex mtx_;
+        std::condition_variable cv_;
+    };
+
+    struct Summary
+    {
+        size_t positions = 0;
+        size_t failed = 0;
+        uint64 nodes = 0;
+        double ms = 0.0;
+
+        double per_second() const { return ms > 0.0 ? double(positions) * 1000.0 / ms : 0.0; }
+    };
+
+    // Searches rec within the limits and fills in the rest of r; false when
+    // rec.fen is not a valid position. Between positions the searcher calls
+    // new_search on its table, or clears it with opt.clear_hash; only a cleared
+    // table makes a result independent of the thread count and of which worker
+    // took the position.
+    using Searcher = std::function<bool(const Record &rec, Result &r)>;
+
+    // Called on each worker thread before its first position, so the searcher's
+    // position, history and hash (opt.worker_hash_mb()) are allocated and first
+    // touched by the thread that uses them.
+    using SearcherFactory = std::function<Searcher(unsigned int worker, const Options &opt)>;
+
+    // Runs opt.threads independent single threaded searchers over the file. JSONL
+    // results go to out in input order, the throughput summary to log.
+    //
+    // A harness for the engine search, which this tree does not have yet; until
+    // then only the tests drive it. The nano analyse command line comes with
+    // the search.
+    Summary run(const Options &opt, const SearcherFactory &make_searcher, std::ostream &out, std::ostream &log);
+}
+
+#endif
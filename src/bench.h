@@ -0,0 +1,50 @@
+#pragma once
+
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace Bench {
+
+    // Fixed suite of 50 positions: openings, middlegames and endgames
+    const std::vector<std::string> &positions();
+
+    struct Options
+    {
+        int depth = 6;
+        unsigned int threads = 1;
+        size_t hash_mb = 16;
+    };
+
+    // "[depth] [threads] [hash]", a missing or invalid value keeps its default
+    Options parse(const std::vector<std::string> &args);
+
+    struct Report
+    {
+        size_t positions = 0;
+        uint64 nodes = 0;
+        double ms = 0.0;
+
+        uint64 nps() const { return ms > 0.0 ? uint64(double(nodes) * 1000.0 / ms) : 0; }
+
+        // Tail in the usual bench format, "Nodes searched" is the signature
+        void print(std::ostream &os) const;
+    };
+
+    // Searches one position to the bench depth from an empty table, returns its nodes
+    using Searcher = std::function<uint64(const std::string &fen)>;
+
+    // Runs search on each position that Notation::parse_fen accepts and prints a
+    // line per position to os. Single threaded the node count only changes with
+    // the search itself, so it doubles as a functional signature; timings are for
+    // comparing versions on the same machine.
+    Report run(const Searcher &search, std::ostream &os);
+}
+
+#endif
@@ -1,220 +1,231 @@
 
+#include <bit>
+
 #include "bitboards.h"
-#include "bits.h"
 
 namespace Bitboards
 {
+    namespace
+    {
+        constexpr int knight_steps[8] = {10, -6, -10, 6, 17, 15, -15, -17};
+        constexpr int bishop_steps[4] = {-7, -9, 7, 9};
+        constexpr int king_steps[8] = {-1, 1, 8, -8, -9, -7, 9, 7};
+
+        // king zone steps
+        constexpr int zsteps[24] = {
+            -1, 1, 8, -8, -9, -7, 9, 7, // normal kmask
+            -2, 2, -2 + 8, -2 - 8, 2 + 8, 2 - 8, -2 - 16, -2 + 16, 2 - 16, 2 + 16,
+            -16, 16, -16 - 1, -16 + 1, 16 + 1, 16 - 1};
+
+        // squares reachable by single steps which stay within max_dist rows/cols
+        template <size_t N>
+        constexpr uint64 step_mask(SquareType_t s, const int (&steps)[N], int max_dist)
+        {
+            uint64 bm = 0ULL;
+            for (auto &step : steps)
+            {
+                int to = s + step;
+                if (Util::on_board(to) &&
+                    Util::col_dist(s, to) <= max_dist &&
+                    Util::row_dist(s, to) <= max_dist)
+                    bm |= (1ULL << to);
+            }
+            return bm;
+        }
+    }
 
     // **Global Bitboard Data**
-    uint64 row_masks[NUM_RANKS];
-    uint64 col_masks[NUM_FILES];
-    uint64 bishop_masks[NUM_SQUARES];                       // Bishop mask (trimmed outer board edges)
-    uint64 pawn_masks[PAWN_DIRS];                           // 2nd - 6th rank mask for pawns
-    uint64 pawn_attacks[PAWN_DIRS][NUM_SQUARES];            // Pawn step attacks
-    uint64 pawn_mask_left[PAWN_DIRS];                       // Pawn captures (left)
-    uint64 pawn_mask_right[PAWN_DIRS];                      // Pawn captures (right)
-    uint64 knight_masks[NUM_SQUARES];                       // Knight move masks
-    uint64 king_masks[NUM_SQUARES];                         // King move masks
-    uint64 king_checks[5][NUM_SQUARES];                     // King check masks
-    uint64 king_zone[NUM_SQUARES];                          // Large zone around king (for evaluation)
-    uint64 king_flanks[8];                                  // 3-row squares (including king square) for pawn cover detection
-    uint64 rook_masks[NUM_SQUARES];                         // Rook mask (trimmed outer board edges)
-    uint64 king_pawn_storms[PAWN_DIRS][2];                  // Detect enemy pawn storms
-    uint64 bishop_attacks[NUM_SQUARES];                     // Precomputed bishop attack bitboards
-    uint64 rook_attacks[NUM_SQUARES];                       // Precomputed rook attack bitboards
-    uint64 small_center_mask;                               // Small center region mask
-    uint64 big_center_mask;                                 // Large center region mask
-    uint64 square_masks[NUM_SQUARES];                       // Single square bitboards
-    uint64 diagonal_masks[NUM_SQUARES];                     // Diagonal masks
-    uint64 between_squares[NUM_SQUARES][NUM_SQUARES];       // Squares between aligned squares
-    uint64 passed_pawn_masks[PAWN_DIRS][NUM_SQUARES];       // Passed pawn masks
-    uint64 neighbor_columns[NUM_FILES];                     // Neighboring column bitboards
-    uint64 colored_squares[2];                              // Bitboards for light/dark squares
-    uint64 front_regions[PAWN_DIRS][NUM_SQUARES];           // Front-region bitboards for pawn structure
-    uint64 pawn_majority_masks[3];                          // Pawn majority bitboards (1 for each flank)
-    unsigned reduction_table[2][2][NUM_SQUARES][NUM_SQUARES]; // Max search depth reduction table
-    uint64 board_edges;                                     // Mask for board edges
-    uint64 board_corners;                                   // Mask for board corners
-
-} // namespace bitboards
-
-void Bitboards::load()
-{
-    std::vector<std::vector<int>> steps = {
-        {},                                 // pawn
-        {10, -6, -10, 6, 17, 15, -15, -17}, // knight
-        {-7, -9, 7, 9},                     // bishop
-        {-1, 1, 8, -8},                     // rook
-        {},                                 // queen
-        {-1, 1, 8, -8, -9, -7, 9, 7}        // king
-    };
-
-    // king zone steps
-    std::vector<int> zsteps = {
-        -1, 1, 8, -8, -9, -7, 9, 7, // normal kmask
-        -2, 2, -2 + 8, -2 - 8, 2 + 8, 2 - 8, -2 - 16, -2 + 16, 2 - 16, 2 + 16,
-        -16, 16, -16 - 1, -16 + 1, 16 + 1, 16 - 1};
-
-    for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
-        square_masks[s] = (1ULL << s);
+    // Every table is a constant expression: nothing is computed at startup.
+    constexpr SquareMasks square_masks = []
+    {
+        SquareMasks sm{};
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+            sm[s] = (1ULL << s);
+        return sm;
+    }();
 
     // row/col masks
-    for (RowType_t r = Row::R1; r <= Row::R8; ++r)
+    constexpr std::array<uint64, NUM_RANKS> row_masks = []
     {
-        uint64 rw = 0ULL;
-        uint64 cl = 0ULL;
+        std::array<uint64, NUM_RANKS> rm{};
+        for (RowType_t r = Row::R1; r <= Row::R8; ++r)
+            for (ColType_t c = Col::A; c <= Col::H; ++c)
+                rm[r] |= square_masks[r * 8 + c];
+        return rm;
+    }();
+
+    constexpr std::array<uint64, NUM_FILES> col_masks = []
+    {
+        std::array<uint64, NUM_FILES> cm{};
         for (ColType_t c = Col::A; c <= Col::H; ++c)
-        {
-            cl |= square_masks[c * 8 + r];
-            rw |= square_masks[r * 8 + c];
-        }
-        row_masks[r] = rw;
-        col_masks[r] = cl;
-    }
+            for (RowType_t r = Row::R1; r <= Row::R8; ++r)
+                cm[c] |= square_masks[r * 8 + c];
+        return cm;
+    }();
 
     // pawn majority masks
-    pawn_majority_masks[0] = col_masks[Col::A] | col_masks[Col::B] | col_masks[Col::C];
-    pawn_majority_masks[1] = col_masks[Col::D] | col_masks[Col::E];
-    pawn_majority_masks[2] = col_masks[Col::F] | col_masks[Col::G] | col_masks[Col::H];
+    constexpr std::array<uint64, 3> pawn_majority_masks = {
+        col_masks[Col::A] | col_masks[Col::B] | col_masks[Col::C],
+        col_masks[Col::D] | col_masks[Col::E],
+        col_masks[Col::F] | col_masks[Col::G] | col_masks[Col::H]};
 
     // helpful definitions for board corners/edges
-    board_edges = row_masks[Row::R1] | col_masks[Col::A] | row_masks[Row::R8] | col_masks[Col::H];
-    board_corners = square_masks[Square::A1] | square_masks[Square::H1] | square_masks[Square::H8] | square_masks[Square::A8];
+    constexpr uint64 board_edges = row_masks[Row::R1] | col_masks[Col::A] | row_masks[Row::R8] | col_masks[Col::H];
+    constexpr uint64 board_corners = square_masks[Square::A1] | square_masks[Square::H1] | square_masks[Square::H8] | square_masks[Square::A8];
 
     // pawn masks for captures/promotions
-    pawn_masks[Color::WHITE] = row_masks[Row::R2] | row_masks[Row::R3] | row_masks[Row::R4] | row_masks[Row::R5] | row_masks[Row::R6];
-    pawn_masks[Color::BLACK] = row_masks[Row::R3] | row_masks[Row::R4] | row_masks[Row::R5] | row_masks[Row::R6] | row_masks[Row::R7];
-    for (ColorType_t color = Color::WHITE; color <= Color::BLACK; ++color)
+    constexpr std::array<uint64, PAWN_DIRS> pawn_masks = {
+        row_masks[Row::R2] | row_masks[Row::R3] | row_masks[Row::R4] | row_masks[Row::R5] | row_masks[Row::R6],
+        row_masks[Row::R3] | row_masks[Row::R4] | row_masks[Row::R5] | row_masks[Row::R6] | row_masks[Row::R7]};
+
+    constexpr std::array<uint64, PAWN_DIRS> pawn_mask_left = []
     {
-        pawn_mask_left[color] = 0ULL;
-        pawn_mask_right[color] = 0ULL;
-        for (int r = (color == Color::WHITE ? 1 : 2); r <= (color == Color::WHITE ? 5 : 6); ++r)
-        {
-            for (int c = 0; c <= 6; ++c)
-                pawn_mask_left[color] |= square_masks[r * 8 + c];
-            for (int c = 1; c <= 7; ++c)
-                pawn_mask_right[color] |= square_masks[r * 8 + c];
-        }
-    }
+        std::array<uint64, PAWN_DIRS> pm{};
+        for (ColorType_t color = Color::WHITE; color <= Color::BLACK; ++color)
+            for (int r = (color == Color::WHITE ? 1 : 2); r <= (color == Color::WHITE ? 5 : 6); ++r)
+                for (int c = 0; c <= 6; ++c)
+                    pm[color] |= square_masks[r * 8 + c];
+        return pm;
+    }();
+
+    constexpr std::array<uint64, PAWN_DIRS> pawn_mask_right = []
+    {
+        std::array<uint64, PAWN_DIRS> pm{};
+        for (ColorType_t color = Color::WHITE; color <= Color::BLACK; ++color)
+            for (int r = (color == Color::WHITE ? 1 : 2); r <= (color == Color::WHITE ? 5 : 6); ++r)
+                for (int c = 1; c <= 7; ++c)
+                    pm[color] |= square_masks[r * 8 + c];
+        return pm;
+    }();
 
     // central control masks
-    big_center_mask =   square_masks[Square::C3] | square_masks[Square::D3] | square_masks[Square::E3] | square_masks[Square::F3] |
-                        square_masks[Square::C4] | square_masks[Square::D4] | square_masks[Square::E4] | square_masks[Square::F4] |
-                        square_masks[Square::C5] | square_masks[Square::D5] | square_masks[Square::E5] | square_masks[Square::F5] |
-                        square_masks[Square::C6] | square_masks[Square::D6] | square_masks[Square::E6] | square_masks[Square::F6];
-    small_center_mask = square_masks[Square::C4] | square_masks[Square::C5] | square_masks[Square::D4] |
-                        square_masks[Square::D5] | square_masks[Square::E4] | square_masks[Square::E5];
+    constexpr uint64 big_center_mask =
+        square_masks[Square::C3] | square_masks[Square::D3] | square_masks[Square::E3] | square_masks[Square::F3] |
+        square_masks[Square::C4] | square_masks[Square::D4] | square_masks[Square::E4] | square_masks[Square::F4] |
+        square_masks[Square::C5] | square_masks[Square::D5] | square_masks[Square::E5] | square_masks[Square::F5] |
+        square_masks[Square::C6] | square_masks[Square::D6] | square_masks[Square::E6] | square_masks[Square::F6];
+    constexpr uint64 small_center_mask =
+        square_masks[Square::C4] | square_masks[Square::C5] | square_masks[Square::D4] |
+        square_masks[Square::D5] | square_masks[Square::E4] | square_masks[Square::E5];
 
     // king flank masks
-    uint64 roi = ~(row_masks[Row::R1] | row_masks[Row::R7]);
-    for (ColType_t c = Col::A; c <= Col::H; ++c)
+    constexpr std::array<uint64, 8> king_flanks = []
     {
-        king_flanks[c] = 0ULL;
-        int lidx = (c - 1 < 0 ? 0 : c - 1);
-        int ridx = (c + 1 > Col::H ? Col::H : c + 1);
-        uint64 mask = c <= Col::C || c >= Col::F ? 
-            (col_masks[lidx] | col_masks[c] | col_masks[ridx]) : 
-            (col_masks[lidx - 1] | col_masks[lidx] | col_masks[c] | col_masks[ridx] | col_masks[ridx + 1]);
-        king_flanks[c] |= roi & mask;
-    }
+        std::array<uint64, 8> kf{};
+        uint64 roi = ~(row_masks[Row::R1] | row_masks[Row::R7]);
+        for (ColType_t c = Col::A; c <= Col::H; ++c)
+        {
+            int lidx = (c - 1 < 0 ? 0 : c - 1);
+            int ridx = (c + 1 > Col::H ? Col::H : c + 1);
+            uint64 mask = c <= Col::C || c >= Col::F ?
+                (col_masks[lidx] | col_masks[c] | col_masks[ridx]) :
+                (col_masks[lidx - 1] | col_masks[lidx] | col_masks[c] | col_masks[ridx] | col_masks[ridx + 1]);
+            kf[c] = roi & mask;
+        }
+        return kf;
+    }();
+
+    constexpr std::array<uint64, 2> colored_squares = []
+    {
+        std::array<uint64, 2> cs{};
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+        {
+            if ((Util::row(s) % 2 == 0) && (s % 2 == 0))
+                cs[Color::BLACK] |= square_masks[s];
+            else if ((Util::row(s) % 2) != 0 && (s % 2 != 0))
+                cs[Color::BLACK] |= square_masks[s];
+            else
+                cs[Color::WHITE] |= square_masks[s];
+        }
+        return cs;
+    }();
 
-    for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+    // Search reduction array
+    // Index assignment [pv_node][improving][depth][move count]
+    constexpr ReductionTable reduction_table = []
     {
-        if ((Util::row(s) % 2 == 0) && (s % 2 == 0))
-            colored_squares[Color::BLACK] |= square_masks[s];
-        else if ((Util::row(s) % 2) != 0 && (s % 2 != 0))
-            colored_squares[Color::BLACK] |= square_masks[s];
-        else
-            colored_squares[Color::WHITE] |= square_masks[s];
-
-        // Search reduction array
-        // Index assignment [pv_node][improving][depth][move count]
+        ReductionTable rt{};
         for (int sd = 0; sd < 64; ++sd) {
             for (int mc = 0; mc < 64; ++mc) {
                 // pv nodes
-                double small_r  = log(double(sd + 1)) * log(double(mc + 1)) / 2.0;
-                double big_r    = 0.25 + log(double(sd + 1)) * log(double(mc + 1)) / 1.5;
+                double small_r  = Util::ln(double(sd + 1)) * Util::ln(double(mc + 1)) / 2.0;
+                double big_r    = 0.25 + Util::ln(double(sd + 1)) * Util::ln(double(mc + 1)) / 1.5;
 
                 // pv-nodes
-                reduction_table[1][0][sd][mc] = int(big_r >= 1.0 ? big_r + 0.5 : 0);
-                reduction_table[1][1][sd][mc] = int(small_r >= 1.0 ? small_r + 0.5 : 0);
+                rt[1][0][sd][mc] = int(big_r >= 1.0 ? big_r + 0.5 : 0);
+                rt[1][1][sd][mc] = int(small_r >= 1.0 ? small_r + 0.5 : 0);
 
                 // non-pv nodes
-                reduction_table[0][0][sd][mc] = reduction_table[1][0][sd][mc] + 1;
-                reduction_table[0][1][sd][mc] = reduction_table[1][1][sd][mc] + 1;
+                rt[0][0][sd][mc] = rt[1][0][sd][mc] + 1;
+                rt[0][1][sd][mc] = rt[1][1][sd][mc] + 1;
             }
         }
+        return rt;
+    }();
 
-        // knight step attacks
-        uint64 bm = 0ULL;
-        for (auto &step : steps[Piece::KNIGHT])
-        {
-            int to = s + step;
-            if (Util::on_board(to) &&
-                Util::col_dist(s, to) <= 2 &&
-                Util::row_dist(s, to) <= 2)
-                bm |= square_masks[to];
-        }
-        knight_masks[s] = bm;
-
-        // king step attacks
-        bm = 0ULL;
-        for (auto &step : steps[Piece::KING])
-        {
-            int to = s + step;
-            if (Util::on_board(to) &&
-                Util::col_dist(s, to) <= 1 &&
-                Util::row_dist(s, to) <= 1)
-                bm |= square_masks[to];
-        }
-        king_masks[s] = bm;
-
-        // king zone bitboard (for eval)
-        bm = 0ULL;
-        for (auto &step : zsteps)
+    // knight step attacks
+    constexpr SquareMasks knight_masks = []
+    {
+        SquareMasks km{};
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+            km[s] = step_mask(s, knight_steps, 2);
+        return km;
+    }();
+
+    // king step attacks
+    constexpr SquareMasks king_masks = []
+    {
+        SquareMasks km{};
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+            km[s] = step_mask(s, king_steps, 1);
+        return km;
+    }();
+
+    // king zone bitboard (for eval)
+    constexpr SquareMasks king_zone = []
+    {
+        SquareMasks kz{};
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+            kz[s] = step_mask(s, zsteps, 2);
+        return kz;
+    }();
+
+    // pawn attack masks for each color
+    constexpr std::array<SquareMasks, PAWN_DIRS> pawn_attacks = []
+    {
+        std::array<SquareMasks, PAWN_DIRS> pa{};
+        constexpr int pawn_steps[2][2] = {{9, 7}, {-7, -9}};
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+            for (ColorType_t c = Color::WHITE; c <= Color::BLACK; ++c)
+                pa[c][s] = step_mask(s, pawn_steps[c], 1);
+        return pa;
+    }();
+
+    // front region for each square
+    constexpr std::array<SquareMasks, PAWN_DIRS> front_regions = []
+    {
+        std::array<SquareMasks, PAWN_DIRS> fr{};
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
         {
-            int to = s + step;
-            if (Util::on_board(to) &&
-                Util::col_dist(s, to) <= 2 &&
-                Util::row_dist(s, to) <= 2)
-                bm |= square_masks[to];
+            for (auto r = Util::row(s) + 1; r <= Row::R8; ++r)
+                fr[Color::WHITE][s] |= row_masks[r];
+            for (auto r = Util::row(s) - 1; r >= Row::R1; --r)
+                fr[Color::BLACK][s] |= row_masks[r];
         }
-        king_zone[s] = bm;
+        return fr;
+    }();
 
-        // pawn attack masks for each color
-        int pawn_steps[2][2] = {{9, 7}, {-7, -9}};
-        for (ColorType_t c = Color::WHITE; c <= Color::BLACK; ++c)
+    // between bitboard
+    constexpr std::array<SquareMasks, NUM_SQUARES> between_squares = []
+    {
+        std::array<SquareMasks, NUM_SQUARES> bs{};
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
         {
-            pawn_attacks[c][s] = 0ULL;
-            for (auto &step : pawn_steps[c])
+            for (SquareType_t s2 = Square::A1; s2 <= Square::H8; ++s2)
             {
-                int to = s + step;
-                if (Util::on_board(to) &&
-                    Util::row_dist(s, to) < 2 &&
-                    Util::col_dist(s, to) < 2)
-                {
-                    pawn_attacks[c][s] |= square_masks[to];
-                }
-            }
-        }
+                if (s == s2)
+                    continue;
 
-        // front region for each square
-        for (ColorType_t c = Color::WHITE; c <= Color::BLACK; ++c)
-        {
-            front_regions[c][s] = 0ULL;
-            if (c == Color::WHITE)
-                for (auto r = Util::row(s) + 1; r <= Row::R8; ++r)
-                    front_regions[c][s] |= row_masks[r];
-            else
-                for (auto r = Util::row(s) - 1; r >= Row::R1; --r)
-                    front_regions[c][s] |= row_masks[r];
-        }
-
-        // between bitboard
-        for (SquareType_t s2 = Square::A1; s2 <= Square::H8; ++s2)
-        {
-            if (s != s2)
-            {
                 uint64 btwn = 0ULL;
                 int delta = 0;
 
@@ -245,76 +256,131 @@ void Bitboards::load()
                         iter++;
                     } while (sq != s2);
                 }
-                between_squares[s][s2] = btwn;
+                bs[s][s2] = btwn;
             }
         }
+        return bs;
+    }();
 
-        // passed pawn masks
+    // passed pawn masks
+    constexpr std::array<SquareMasks, PAWN_DIRS> passed_pawn_masks = []
+    {
+        std::array<SquareMasks, PAWN_DIRS> pp{};
         uint64 roi = ~(row_masks[0] | row_masks[7]);
-        if (square_masks[s] & roi) {
-            neighbor_columns[Util::col(s)] = 0ULL;
-            for (ColorType_t c = Color::WHITE; c <= Color::BLACK; ++c) {
-                passed_pawn_masks[c][s] = 0ULL;
-
-                uint64 neighbors =
-                    (king_masks[s] & row_masks[Util::row(s)]) | square_masks[s];
-
-                while (neighbors) {
-                    int sq = Bits::pop_lsb(neighbors);
-                    passed_pawn_masks[c][s] |=
-                        Util::squares_infront(col_masks[Util::col(sq)], c, sq);
-                    if (s != sq)
-                        neighbor_columns[Util::col(s)] |= col_masks[Util::col(sq)];
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+        {
+            if (!(square_masks[s] & roi))
+                continue;
+            for (ColorType_t c = Color::WHITE; c <= Color::BLACK; ++c)
+            {
+                uint64 neighbors = (king_masks[s] & row_masks[Util::row(s)]) | square_masks[s];
+                while (neighbors)
+                {
+                    int sq = std::countr_zero(neighbors);
+                    neighbors &= neighbors - 1;
+                    pp[c][s] |= Util::squares_infront(col_masks[Util::col(sq)], c, sq);
                 }
             }
         }
+        return pp;
+    }();
+
+    constexpr std::array<uint64, NUM_FILES> neighbor_columns = []
+    {
+        std::array<uint64, NUM_FILES> nc{};
+        for (ColType_t c = Col::A; c <= Col::H; ++c)
+        {
+            if (c > Col::A)
+                nc[c] |= col_masks[c - 1];
+            if (c < Col::H)
+                nc[c] |= col_masks[c + 1];
+        }
+        return nc;
+    }();
 
-        // bishop diagonal masks (outer bits trimmed)
-        bm = 0ULL;
-        uint64 trim = 0ULL;
-        for (auto &step : steps[Piece::BISHOP])
+    // bishop diagonal attacks and masks (outer bits trimmed)
+    constexpr SquareMasks bishop_attacks = []
+    {
+        SquareMasks ba{};
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
         {
-            int j = 0;
-            while (true)
+            uint64 bm = 0ULL;
+            for (auto &step : bishop_steps)
             {
-                int to = s + (j++) * step;
-                if (Util::on_board(to) && Util::on_diagonal(s, to))
-                    bm |= square_masks[to];
-                else
-                    break;
+                int j = 0;
+                while (true)
+                {
+                    int to = s + (j++) * step;
+                    if (Util::on_board(to) && Util::on_diagonal(s, to))
+                        bm |= square_masks[to];
+                    else
+                        break;
+                }
             }
+            ba[s] = bm;
         }
-        trim = square_masks[s] | (bm & board_edges);
-        bishop_attacks[s] = bm;
-        bm ^= trim;
-        bishop_masks[s] = bm;
-
-        // rook masks (outer-bits trimmed)
-        bm = (row_masks[Util::row(s)] | col_masks[Util::col(s)]);
-        rook_attacks[s] = bm;
-        trim = square_masks[s] | square_masks[8 * Util::row(s)] | square_masks[8 * Util::row(s) + 7] |
-                square_masks[Util::col(s)] | square_masks[Util::col(s) + 56];
-        bm ^= trim;
-        rook_masks[s] = bm;
-
-        // king check mask
-        king_checks[Piece::KNIGHT][s]    = knight_masks[s];
-        king_checks[Piece::BISHOP][s]    = bishop_attacks[s];
-        king_checks[Piece::ROOK][s]      = rook_attacks[s];
-        king_checks[Piece::QUEEN][s]     = bishop_attacks[s] | rook_attacks[s];
-    }
+        return ba;
+    }();
+
+    constexpr SquareMasks bishop_masks = []
+    {
+        SquareMasks bm{};
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+            bm[s] = bishop_attacks[s] ^ (square_masks[s] | (bishop_attacks[s] & board_edges));
+        return bm;
+    }();
+
+    // rook attacks and masks (outer-bits trimmed)
+    constexpr SquareMasks rook_attacks = []
+    {
+        SquareMasks ra{};
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+            ra[s] = row_masks[Util::row(s)] | col_masks[Util::col(s)];
+        return ra;
+    }();
+
+    constexpr SquareMasks rook_masks = []
+    {
+        SquareMasks rm{};
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+        {
+            uint64 trim = square_masks[s] | square_masks[8 * Util::row(s)] | square_masks[8 * Util::row(s) + 7] |
+                          square_masks[Util::col(s)] | square_masks[Util::col(s) + 56];
+            rm[s] = rook_attacks[s] ^ trim;
+        }
+        return rm;
+    }();
+
+    // king check mask
+    constexpr std::array<SquareMasks, 5> king_checks = []
+    {
+        std::array<SquareMasks, 5> kc{};
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+        {
+            kc[Piece::KNIGHT][s]    = knight_masks[s];
+            kc[Piece::BISHOP][s]    = bishop_attacks[s];
+            kc[Piece::ROOK][s]      = rook_attacks[s];
+            kc[Piece::QUEEN][s]     = bishop_attacks[s] | rook_attacks[s];
+        }
+        return kc;
+    }();
 
     // King pawn storm detection
-    king_pawn_storms[Color::WHITE][0] = between_squares[Square::F2][Square::F5] |
-                                        between_squares[Square::G2][Square::G5] |
-                                        between_squares[Square::H2][Square::H5];
-    king_pawn_storms[Color::WHITE][1] = between_squares[Square::A2][Square::A5] |
-                                        between_squares[Square::B2][Square::B5] |
-                                        between_squares[Square::C2][Square::C5];
-    king_pawn_storms[Color::BLACK][0] = between_squares[Square::F7][Square::F4] |
-                                        between_squares[Square::G7][Square::G4] |
-                                        between_squares[Square::H7][Square::H4];
-    king_pawn_storms[Color::BLACK][1] = between_squares[Square::A7][Square::A4] |
-                                        between_squares[Square::B7][Square::B4] |
-                                        between_squares[Square::C7][Square::C4];
-}
+    constexpr std::array<std::array<uint64, 2>, PAWN_DIRS> king_pawn_storms = {{
+        {between_squares[Square::F2][Square::F5] |
+         between_squares[Square::G2][Square::G5] |
+         between_squares[Square::H2][Square::H5],
+         between_squares[Square::A2][Square::A5] |
+         between_squares[Square::B2][Square::B5] |
+         between_squares[Square::C2][Square::C5]},
+        {between_squares[Square::F7][Square::F4] |
+         between_squares[Square::G7][Square::G4] |
+         between_squares[Square::H7][Square::H4],
+         between_squares[Square::A7][Square::A4] |
+         between_squares[Square::B7][Square::B4] |
+         between_squares[Square::C7][Square::C4]}}};
+
+} // namespace bitboards
+
+// Tables are compile-time constants, kept so callers need not know.
+void Bitboards::load() { }
@@ -1,52 +1,178 @@
 
-#include "hashtable.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
 #include <xmmintrin.h>
+#include <emmintrin.h>
 #include <mmintrin.h>
 
+#include "hashtable.h"
+#include "numa.h"
+#include "threads.h"
+#include "zobrist.h"
+
 hash_table ttable;
 
-inline size_t pow2(size_t x) {
-    return x <= 2 ? 2 : 1ULL << (64 - __builtin_clzll(x - 1));
+#ifdef NANO_TT_STATS
+// Live per-thread counters, plus the totals of threads that have exited
+static std::mutex stats_mutex;
+static std::vector<tt_thread_counters*> live_counters;
+static tt_counters retired_counters;
+
+tt_thread_counters::tt_thread_counters() {
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	live_counters.push_back(this);
+}
+
+tt_thread_counters::~tt_thread_counters() {
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	for (int i = 0; i < stat_count; ++i)
+		retired_counters.n[i] += n[i].load(std::memory_order_relaxed);
+	live_counters.erase(std::find(live_counters.begin(), live_counters.end(), this));
+}
+#endif
+
+tt_counters hash_table::stats() {
+	tt_counters total;
+#ifdef NANO_TT_STATS
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	total = retired_counters;
+	for (auto* c : live_counters)
+		for (int i = 0; i < stat_count; ++i)
+			total.n[i] += c->n[i].load(std::memory_order_relaxed);
+#endif
+	return total;
+}
+
+void hash_table::reset_stats() {
+#ifdef NANO_TT_STATS
+	std::lock_guard<std::mutex> lock(stats_mutex);
+	retired_counters = tt_counters();
+	for (auto* c : live_counters)
+		for (int i = 0; i < stat_count; ++i)
+			c->n[i].store(0, std::memory_order_relaxed);
+#endif
 }
 
+hash_table::hash_table(size_t sizeMb) : sz_mb(0), cluster_count(0), workers(nullptr), generation(0), gen(&generation), huge_pages(true), entries(nullptr),
+	busy(new std::atomic<uint64>[busy_slots]()) {
+	if (!resize(sizeMb))
+		throw std::bad_alloc();
+}
 
-hash_table::hash_table() : sz_mb(0), cluster_count(0) {
-	resize(128);
+static size_t clusters_for(size_t sizeMb) {
+	return std::max<size_t>(1024 * 1024 * sizeMb / sizeof(hash_cluster), 1024);
 }
 
-void hash_table::resize(size_t sizeMb) {
+// The new table is allocated before the old one is released, so on failure
+// the old table is kept as it was.
+bool hash_table::resize(size_t sizeMb) {
+	const size_t old_mb = sz_mb;
 	sz_mb = sizeMb;
-	cluster_count = 1024 * 1024 * sz_mb / sizeof(hash_cluster);
-	cluster_count = pow2(cluster_count);
-	if (cluster_count < 1024) 
-		cluster_count = 1024;
-	if (entries.get() != nullptr)
-		entries.reset();
-
-	entries = std::unique_ptr<hash_cluster[]>(new hash_cluster[cluster_count]());
+	if (!shared_name.empty() && attach_shared())
+		return true;
+
+	const size_t clusters = clusters_for(sz_mb);
+	Memory::Block b = Memory::alloc(sizeof(hash_cluster) * clusters, huge_pages);
+	if (!b.ptr) {
+		sz_mb = old_mb;
+		return false;
+	}
+	shared_name.clear();
+	Memory::release(mem);
+	gen = &generation;
+	mem = b;
+	cluster_count = clusters;
+	entries = static_cast<hash_cluster*>(mem.ptr);
+	Numa::interleave(mem); // every thread probes everywhere, so no node should hold it all
 	clear();
+	return true;
 }
 
+// A shared table keeps its generation in the segment header, so a search
+// started by any attached process ages the entries of all of them alike.
+void hash_table::new_search() {
+	std::atomic_ref<uint8> g = generation_ref();
+	uint8 old = g.load(std::memory_order_relaxed);
+	while (!g.compare_exchange_weak(old, uint8((old + 1) & generation_mask), std::memory_order_relaxed))
+		;
+}
 
-void hash_table::clear() {
-	memset(entries.get(), 0, sizeof(hash_cluster) * cluster_count);
+// Reallocates the table when the setting changes (the contents are dropped)
+void hash_table::set_huge_pages(bool enabled) {
+	if (enabled == huge_pages)
+		return;
+	huge_pages = enabled;
+	if (!resize(sz_mb))
+		huge_pages = !enabled;
 }
 
 
+// Zeroes [begin, end) with non-temporal stores: the table is far larger than
+// the caches, so there is no point in pulling every line in first.
+static void stream_zero(char* begin, char* end) {
+#if defined(__SSE2__) || defined(_M_X64)
+	const __m128i zero = _mm_setzero_si128();
+	for (char* p = begin; p < end; p += 64) {
+		_mm_stream_si128(reinterpret_cast<__m128i*>(p), zero);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(p + 16), zero);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(p + 32), zero);
+		_mm_stream_si128(reinterpret_cast<__m128i*>(p + 48), zero);
+	}
+	_mm_sfence();
+#else
+	memset(begin, 0, size_t(end - begin));
+#endif
+}
 
-bool hash_table::fetch(const U64& key, hash_data& e) {
-	entry* stored = first_entry(key);
+// A shared table is zeroed once, by the process that creates the segment.
+// Every GUI sends uci and ucinewgame, and a process joining the segment must
+// not wipe the entries and reset the aging of the others.
+void hash_table::clear() {
+	if (!shared_name.empty())
+		return;
+	generation_ref().store(0, std::memory_order_relaxed);
+	zero_clusters(entries, cluster_count);
+}
 
-	{ // prefetch.. ?
-		char* addr = (char*)stored;
-		_mm_prefetch(addr, _MM_HINT_T0);
-		_mm_prefetch(addr + 32, _MM_HINT_T0);
+// One contiguous, 2 MB aligned slice per search thread, zeroed as a task on
+// that pool. After resize this is the first touch of the table; on NUMA
+// systems the interleave policy set in resize decides the node of each page.
+void hash_table::zero_clusters(hash_cluster* first, size_t count) {
+	const size_t bytes = sizeof(hash_cluster) * count;
+	const unsigned int slices = workers ? std::max(workers->size(), 1u) : 1;
+	const size_t page = 2 * 1024 * 1024;
+	const size_t chunk = ((bytes / slices + page - 1) / page) * page;
+	char* base = reinterpret_cast<char*>(first);
+
+	if (slices == 1 || chunk >= bytes) {
+		stream_zero(base, base + bytes);
+		return;
 	}
 
+	TaskGroup group;
+	for (size_t offset = 0; offset < bytes; offset += chunk) {
+		char* end = base + std::min(bytes, offset + chunk);
+		workers->enqueue(group, [=] { stream_zero(base + offset, end); });
+	}
+	workers->wait(group);
+}
+
+bool hash_table::fetch(const uint64& key, hash_data& e) {
+	entry* stored = first_entry(key);
+	const uint16 key16 = uint16(key);
 
+	TT_COUNT(stat_probes);
 	for (unsigned i = 0; i < cluster_size; ++i, ++stored) {
-		if ((stored->pkey ^ stored->dkey) == key) {
-			e.decode(stored->dkey);
+		if (stored->matches(key16)) {
+			TT_COUNT(stat_hits);
+			e.decode(*stored);
 			return true;
 		}
 	}
@@ -54,40 +180,252 @@ bool hash_table::fetch(const U64& key, hash_data& e) {
 	return false;
 }
 
-void hash_table::save(const U64& key,
-	const U8& depth,
-	const U8& bound,
-	const U8& age,
+void hash_table::save(const uint64& key,
+	const uint8& depth,
+	const uint8& bound,
 	const Move& m,
-	const int16& score, const bool& pv_node) {
+	const int16& score,
+	const int16& eval, const bool& pv_node) {
 
 	entry* e, * replace;
+	const uint16 key16 = uint16(key);
 
 	e = replace = first_entry(key);
+	TT_COUNT(stat_stores);
+
+	const uint8 current = current_generation();
+	auto worth = [current](entry* x) {
+		return int(x->depth()) - age_weight * ((current - x->age()) & generation_mask) + (x->pv() ? pv_bonus : 0);
+	};
 
 	for (unsigned i = 0; i < cluster_size; ++i, ++e) {
 
-		// empty entry or hash collision
+		// empty entry: take it
 		if (e->empty()) {
+			TT_COUNT(stat_replace_empty);
 			replace = e;
 			break;
 		}
 
-		// collision handling (depth, age and pv node)
-		else if (((e->pkey) ^ (e->dkey)) == key) {
-			if (age - e->age() > 1 && 
-				depth > e->depth() - 4) {  // Avoid replacing deep entries too easily
-				replace = e;
-				break;
-			}
-			if (e->depth() - depth < 0) {
-				replace = e;
-				break;
+		// same position: keep a clearly deeper result from this search, unless the new one is exact
+		if (e->matches(key16)) {
+			if (bound != bound_exact && e->age() == current &&
+				int(depth) + 1 + (pv_node ? pv_bonus : 0) + 4 <= int(e->depth())) {
+				TT_COUNT(stat_skipped);
+				return;
 			}
+			TT_COUNT(stat_replace_same);
+			replace = e;
+			break;
 		}
 
+		// otherwise the least valuable entry of the cluster
+		if (worth(e) < worth(replace))
+			replace = e;
+
+		if (i == cluster_size - 1)
+			TT_COUNT(replace->age() != current ? stat_replace_aged : stat_replace_shallow);
 	}
 
-	replace->encode(depth, bound, age, m, score);
-	replace->pkey = key ^ replace->dkey;
+	// a new position starts without a move, the same position keeps its old one if we have none
+	if (!replace->matches(key16))
+		replace->move16 = 0;
+	replace->encode(key, depth, bound, current, m, score, eval, pv_node);
+}
+
+// Sampled over the first clusters, like the UCI hashfull convention
+int hash_table::hashfull() const {
+	const uint8 current = current_generation();
+	const size_t sample = std::min<size_t>(cluster_count, 1000);
+	size_t used = 0;
+	for (size_t c = 0; c < sample; ++c)
+		for (unsigned i = 0; i < cluster_size; ++i) {
+			const entry& e = entries[c].cluster_entries[i];
+			used += (!e.empty() && e.age() == current);
+		}
+	return int(used * 1000 / (sample * cluster_size));
+}
+
+void hash_table::dump_stats(std::ostream& os) const {
+	static const char* names[stat_count] = {
+		"probes", "hits", "stores", "skipped",
+		"replaced empty", "replaced same", "replaced aged", "replaced shallow" };
+
+	tt_counters c = stats();
+#ifdef NANO_TT_STATS
+	for (int i = 0; i < stat_count; ++i)
+		os << std::setw(18) << names[i] << ": " << c.n[i] << "\n";
+	if (c.n[stat_probes])
+		os << std::setw(18) << "hit rate" << ": " << 100.0 * c.n[stat_hits] / c.n[stat_probes] << "%\n";
+#else
+	(void)names;
+	(void)c;
+	os << "counters: not compiled in (configure with -DNANO_TT_STATS=ON)\n";
+#endif
+
+	// full scan: depth in buckets of 4 plies, age in searches since written
+	const uint8 current = current_generation();
+	size_t depths[16] = {}, ages[generation_mask + 1] = {}, used = 0;
+	for (size_t cl = 0; cl < cluster_count; ++cl)
+		for (unsigned i = 0; i < cluster_size; ++i) {
+			const entry& e = entries[cl].cluster_entries[i];
+			if (e.empty())
+				continue;
+			++used;
+			++depths[std::min((e.depth() - 1) / 4, 15)];
+			++ages[(current - e.age()) & generation_mask];
+		}
+
+	const size_t total = cluster_count * cluster_size;
+	os << "entries: " << used << " of " << total << " (" << 1000 * used / total << " permille), hashfull " << hashfull() << "\n";
+	os << "depth histogram:\n";
+	for (int b = 0; b < 16; ++b)
+		if (depths[b])
+			os << std::setw(5) << b * 4 << (b == 15 ? "+" : "..") << std::setw(12) << depths[b] << "\n";
+	os << "age histogram (searches ago):\n";
+	for (int a = 0; a <= generation_mask; ++a)
+		if (ages[a])
+			os << std::setw(5) << a << std::setw(15) << ages[a] << "\n";
+}
+
+static const char hash_file_magic[8] = { 'N', 'A', 'N', 'O', 'H', 'A', 'S', 'H' };
+static const uint32 hash_file_version = 2; // 2: clusters indexed by index_key
+
+static void fill_header(hash_file_header& h, uint64 cluster_count, uint8 generation) {
+	h.version = hash_file_version;
+	h.cluster_bytes = sizeof(hash_cluster);
+	h.cluster_count = cluster_count;
+	h.zobrist = Zobrist::fingerprint();
+	h.generation = generation;
+}
+
+// Same format, entry layout and key set as ours
+static bool compatible(const hash_file_header& h) {
+	return memcmp(h.magic, hash_file_magic, sizeof(h.magic)) == 0 && h.version == hash_file_version &&
+		h.cluster_bytes == sizeof(hash_cluster) && h.zobrist == Zobrist::fingerprint() &&
+		h.cluster_count >= 1024 && h.generation <= generation_mask;
+}
+
+bool hash_table::save_to(const std::string& path) const {
+	hash_file_header h = {};
+	memcpy(h.magic, hash_file_magic, sizeof(h.magic));
+	fill_header(h, cluster_count, current_generation());
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+	out.write(reinterpret_cast<const char*>(entries), std::streamsize(sizeof(hash_cluster) * cluster_count));
+	return bool(out.flush());
+}
+
+bool hash_table::load_from(const std::string& path) {
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	const std::streamoff file_bytes = in.tellg();
+	hash_file_header h = {};
+	in.seekg(0);
+	if (!in || file_bytes < std::streamoff(sizeof(h)) || !in.read(reinterpret_cast<char*>(&h), sizeof(h)))
+		return false;
+
+	// reject other formats, entry layouts and key sets, and truncated files
+	if (!compatible(h) || uint64(file_bytes) != sizeof(h) + h.cluster_count * sizeof(hash_cluster))
+		return false;
+
+	Memory::Block mapped = Memory::map_file(path, sizeof(h), size_t(h.cluster_count * sizeof(hash_cluster)));
+	if (!mapped.ptr)
+		return false;
+
+	Memory::release(mem);
+	shared_name.clear();
+	mem = mapped;
+	entries = static_cast<hash_cluster*>(mem.ptr);
+	cluster_count = size_t(h.cluster_count);
+	sz_mb = cluster_count * sizeof(hash_cluster) / (1024 * 1024);
+	gen = &generation;
+	generation_ref().store(h.generation, std::memory_order_relaxed);
+	return true;
+}
+
+bool hash_table::set_shared(const std::string& name) {
+	const std::string old = shared_name;
+	shared_name = name;
+	if (!resize(sz_mb)) {
+		shared_name = old;
+		return false;
+	}
+	return shared_name == name;
+}
+
+// The segment starts with the same header as a hash file. The creator publishes
+// it last (magic after a release fence); joiners wait for it and adopt its size.
+bool hash_table::attach_shared() {
+	const size_t want = sizeof(hash_file_header) + sizeof(hash_cluster) * clusters_for(sz_mb);
+	bool created = false;
+	Memory::Block seg = Memory::map_shared(shared_name, want, created);
+	if (!seg.ptr)
+		return false;
+
+	auto* h = static_cast<hash_file_header*>(seg.ptr);
+	hash_cluster* seg_entries = reinterpret_cast<hash_cluster*>(static_cast<char*>(seg.ptr) + sizeof(hash_file_header));
+	if (created) {
+		zero_clusters(seg_entries, clusters_for(sz_mb)); // before the magic is published, no joiner writes yet
+		fill_header(*h, clusters_for(sz_mb), 0);
+		std::atomic_thread_fence(std::memory_order_release);
+		memcpy(h->magic, hash_file_magic, sizeof(h->magic));
+	}
+	else {
+		for (int i = 0; i < 1000 && memcmp(h->magic, hash_file_magic, sizeof(h->magic)) != 0; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (!compatible(*h) || seg.bytes != sizeof(*h) + h->cluster_count * sizeof(hash_cluster)) {
+			Memory::release(seg);
+			return false;
+		}
+	}
+
+	Memory::release(mem);
+	mem = seg;
+	entries = seg_entries;
+	gen = &h->generation;
+	cluster_count = size_t(h->cluster_count);
+	sz_mb = cluster_count * sizeof(hash_cluster) / (1024 * 1024);
+	return true;
+}
+
+tiered_table::tiered_table(hash_table& table, size_t local_bytes, int shallow) :
+	shared(table), slots(nullptr), slot_count(local_bytes / sizeof(entry)), shallow_depth(shallow) {
+	if (slot_count)
+		slots.reset(new entry[slot_count]());
+}
+
+bool tiered_table::fetch(const uint64& key, hash_data& e) {
+	if (slot_count) {
+		entry* s = slot(key);
+		if (s->matches(uint16(key))) {
+			e.decode(*s);
+			return true;
+		}
+	}
+	return shared.fetch(key, e);
+}
+
+// Direct mapped: the newest shallow entry always wins its slot
+void tiered_table::save(const uint64& key,
+	const uint8& depth,
+	const uint8& bound,
+	const Move& m,
+	const int16& score,
+	const int16& eval, const bool& pv_node) {
+
+	if (!slot_count || int(depth) > shallow_depth || pv_node) {
+		shared.save(key, depth, bound, m, score, eval, pv_node);
+		return;
+	}
+	entry* s = slot(key);
+	if (!s->matches(uint16(key)))
+		s->move16 = 0;
+	s->encode(key, depth, bound, shared.current_generation(), m, score, eval, pv_node);
+}
+
+void tiered_table::clear() {
+	if (slot_count)
+		memset(static_cast<void*>(slots.get()), 0, slot_count * sizeof(entry));
 }
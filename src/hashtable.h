@@ -3,109 +3,292 @@
 #ifndef HASHTABLE_H
 #define HASHTABLE_H
 
+#include <atomic>
 #include <memory>
+#include <ostream>
+#include <string>
+#include <xmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
+#include "memory.h"
+#include "threads.h"
 #include "types.h"
-#include "move.h"
 
-const U64 search_bit = (1ULL << 63);
+const uint64 search_bit = (1ULL << 63); // tags a busy_slots word as "being searched"
 
-struct entry {
-	entry() : pkey(0ULL), dkey(0ULL) { }
+enum Bound { bound_low, bound_high, bound_exact, no_bound };
 
-	U64 pkey;  // zobrist hashing
-	U64 dkey;  // 17 bit val, 8 bit depth, 8 bit bound, 8 bit f, 8 bit t, 8 bit type
+// 10 byte entry, 6 per cache line. The cluster is chosen by the high bits of the
+// key (see first_entry), the low 16 bits are kept to tell positions apart. They
+// are stored xor'ed with the rest of the entry, so an entry torn by concurrent
+// writers (threads, or processes sharing the table) fails the key check.
+struct entry {
+	uint16 key16;     // low key bits ^ data16()
+	uint16 move16;    // 6 bit from, 6 bit to, 4 bit type (0 = no move)
+	int16 score;
+	int16 eval;       // static evaluation
+	uint8 depth8;     // depth + 1, 0 = empty slot
+	uint8 genbound8;  // 5 bit generation, 1 bit pv, 2 bit bound
 
-	inline bool empty() { return pkey == 0ULL && dkey == 0ULL; }
+	inline bool empty() const { return depth8 == 0; }
+	inline uint8 depth() const { return depth8; }
+	inline uint8 bound() const { return genbound8 & 0x3; }
+	inline bool pv() const { return (genbound8 & 0x4) != 0; }
+	inline uint8 age() const { return genbound8 >> 3; }
+	inline uint16 data16() const { return uint16(move16 ^ uint16(score) ^ uint16(eval) ^ (depth8 | (genbound8 << 8))); }
+	inline bool matches(const uint16& k16) const { return uint16(key16 ^ data16()) == k16 && !empty(); }
 
-	inline void encode(const U8& depth,
-		const U8& bound,
-		const U8& age,
+	inline void encode(const uint64& key,
+		const uint8& depth,
+		const uint8& bound,
+		const uint8& age,
 		const Move& m,
-		const int16& score) {
-		dkey = 0ULL;
-		dkey |= U64(m.f); // 8 bits;
-		dkey |= (U64(m.t) << 8); // 8 bits
-		dkey |= (U64(m.type) << 16); // 8 bits
-		dkey |= (U64(bound) << 26); // 4 bits;
-		dkey |= (U64(depth + 1) << 30); // 8 bits
-		dkey |= (U64(score < 0 ? -score : score) << 38); // 16 bits
-		dkey |= (U64(score < 0 ? 1ULL : 0ULL) << 54);   // 1 bit
-		dkey |= (U64(age) << 55); // 9 bits .. 
+		const int16& s,
+		const int16& ev,
+		const bool& pv_node) {
+		if (m.type != MoveType::NONE)
+			move16 = uint16(m.from | (m.to << 6) | ((m.type & 0xF) << 12));
+		score = s;
+		eval = ev;
+		depth8 = uint8(depth + 1);
+		genbound8 = uint8((age << 3) | (pv_node ? 0x4 : 0) | (bound & 0x3));
+		key16 = uint16(key) ^ data16();
 	}
-
-	inline U8 depth() { return U8((dkey & 0xFF0000000) >> 30); }
-	inline U8 bound() { return U8((dkey & 0xF000000) >> 26); }
-	inline U8 age() { return U8((dkey & 0x7F80000000000000 >> 55)); }
 };
 
-
-enum Bound { bound_low, bound_high, bound_exact, no_bound };
-
 struct hash_data {
 	char depth;
-	U8 bound;
-	U8 age;
+	uint8 bound;
+	uint8 age;
+	bool pv;
 	int16 score;
-	U16 pkey;
-	U16 dkey;
-	Move move; // 3 bytes
-
-	inline void decode(const U64& dkey) {
-
-		U8 f = U8(dkey & 0xFF);
-		U8 t = U8((dkey & 0xFF00) >> 8);
-		Movetype type = Movetype((dkey & 0xFF0000) >> 16);
-		bound = U8((dkey & 0xF000000) >> 26);
-		depth = U8((dkey & 0xFF0000000) >> 30);
-		score = int16((dkey & 0xFFFF000000000) >> 38);
-		int sign = int(dkey & (1ULL << 54));
-		score = (sign == 1 ? -score : score);
-		age = U8(dkey & 0x7F80000000000000 >> 55);
-
-		move.set(f, t, type);
+	int16 eval;
+	Move move;
+
+	inline void decode(const entry& e) {
+		bound = e.bound();
+		pv = e.pv();
+		age = e.age();
+		depth = char(e.depth8 - 1);
+		score = e.score;
+		eval = e.eval;
+		move = Move();
+		if (e.move16)
+			move.set(uint8(e.move16 & 0x3F), uint8((e.move16 >> 6) & 0x3F), MoveType_t(e.move16 >> 12));
 	}
 };
 
-const unsigned cluster_size = 4;
+const unsigned cluster_size = 6;
+
+// Replacement worth = depth - age_weight * (searches since the entry was written) + pv bonus
+const int age_weight = 8;
+const int pv_bonus = 2;
+const uint8 generation_mask = 0x1F;
+
+// Table indices come from the high bits of key * golden ratio: the keys in
+// zobristrands.h are sparse and below 2^32, so their own high bits are all
+// zero, while the multiply carries every key bit up into the high word.
+inline uint64 index_key(const uint64& key) { return key * 0x9E3779B97F4A7C15ULL; }
 
-struct hash_cluster {
-	// based on entry size = 64 bits / 8 = 8 + 8 bytes
-	// 16 * 4 = 64 bytes, leaving 0 bytes for cache padding
+struct alignas(64) hash_cluster {
+	// 6 * 10 = 60 bytes, 4 bytes of padding to the cache line
 	entry cluster_entries[cluster_size];
 };
 
+static_assert(sizeof(entry) == 10, "entries must stay packed");
+static_assert(sizeof(hash_cluster) == 64, "a cluster must fill exactly one cache line");
+
+// ABDADA: positions some thread is searching right now, one (key | search_bit)
+// word per slot. The compact entries have no bit to spare, so the marks live in
+// this small side table; marks are short lived and it only needs to hold the
+// nodes currently on the threads' stacks.
+const size_t busy_slots = 1 << 14;
+
+
+// TT statistics. The counters are per thread (relaxed loads and stores, no
+// locked increments) and exist only in builds configured with NANO_TT_STATS.
+enum tt_stat {
+	stat_probes, stat_hits, stat_stores, stat_skipped,
+	stat_replace_empty, stat_replace_same, stat_replace_aged, stat_replace_shallow,
+	stat_count
+};
+
+struct tt_counters {
+	uint64 n[stat_count] = {};
+};
+
+#ifdef NANO_TT_STATS
+struct tt_thread_counters {
+	std::atomic<uint64> n[stat_count] = {};
+	tt_thread_counters();
+	~tt_thread_counters();
+};
+
+inline void tt_count(tt_stat s) {
+	thread_local tt_thread_counters local;
+	local.n[s].store(local.n[s].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+#define TT_COUNT(s) tt_count(s)
+#else
+#define TT_COUNT(s) ((void)0)
+#endif
 
 class hash_table {
 private:
 	size_t sz_mb;
 	size_t cluster_count;
-	std::unique_ptr<hash_cluster[]> entries;
-	void alloc(size_t sizeMb);
+	ThreadPool<WorkerThread>* workers; // the search threads clear() runs on
+	uint8 generation;
+	uint8* gen; // &generation, or the shared segment header's so every process ages alike
+	bool huge_pages;
+	std::string shared_name; // POSIX shared-memory segment, empty for a private table
+	Memory::Block mem;
+	hash_cluster* entries;
+	std::unique_ptr<std::atomic<uint64>[]> busy;
+
+	bool attach_shared();
+	void zero_clusters(hash_cluster* first, size_t count);
+	std::atomic<uint64>& busy_slot(const uint64& key) const { return busy[key & (busy_slots - 1)]; }
+	std::atomic_ref<uint8> generation_ref() const { return std::atomic_ref<uint8>(*gen); }
 
 public:
-	hash_table();
+	hash_table() : hash_table(128) {}
+	explicit hash_table(size_t sizeMb); // throws std::bad_alloc when the size cannot be allocated
 	hash_table(const hash_table& o) = delete;
 	hash_table(const hash_table&& o) = delete;
-	~hash_table() {}
+	~hash_table() { Memory::release(mem); }
 
 	hash_table& operator=(const hash_table& o) = delete;
 	hash_table& operator=(const hash_table&& o) = delete;
 
-	void save(const U64& key,
-		const U8& depth,
-		const U8& bound,
-		const U8& age,
+	void save(const uint64& key,
+		const uint8& depth,
+		const uint8& bound,
 		const Move& m,
-		const int16& score, const bool& pv_node);
-	bool fetch(const U64& key, hash_data& e);
-	inline entry* first_entry(const U64& key);
+		const int16& score,
+		const int16& eval, const bool& pv_node);
+	bool fetch(const uint64& key, hash_data& e);
+	inline void prefetch(const uint64& key); // issue early, e.g. with Zobrist::child_key at make-move time
+	inline entry* first_entry(const uint64& key);
+	void clear(); // a no-op on a shared table, which only its creator zeroes
+	void new_search(); // once per search, ages every stored entry
+	uint8 current_generation() const { return generation_ref().load(std::memory_order_relaxed); }
+	bool resize(size_t sizeMb); // false when out of memory, the old table stays
+	void set_huge_pages(bool enabled);
+	// clear() splits the table over these threads (the search pool's, so every
+	// page is first touched by a thread that searches); nullptr clears on the caller
+	void set_threads(ThreadPool<WorkerThread>* pool) { workers = pool; }
+	ThreadPool<WorkerThread>* threads() const { return workers; }
+	std::string page_info() const { return Memory::describe(mem); }
+
+	// ABDADA busy marks. mark_searching returns true when this caller now owns the
+	// mark and must clear_searching it on leaving the node; overlap is set when
+	// another thread already is inside the same position. A slot held by a
+	// different position is left alone (the node just goes unmarked).
+	inline bool mark_searching(const uint64& key, bool& overlap);
+	void clear_searching(const uint64& key) { busy_slot(key).store(0, std::memory_order_relaxed); }
+	bool is_searching(const uint64& key) const { return busy_slot(key).load(std::memory_order_relaxed) == (key | search_bit); }
+
+	int hashfull() const; // permille of sampled entries written in this generation
+	static tt_counters stats(); // sum over all threads, zero without NANO_TT_STATS
+	static void reset_stats();
+	void dump_stats(std::ostream& os) const; // counters and a depth/age histogram of resident entries
+
+	// Snapshot to / restore from disk. load_from maps the file copy-on-write, so a
+	// multi-GB table pages in lazily; the table takes the size stored in the file.
+	bool save_to(const std::string& path) const;
+	bool load_from(const std::string& path);
+
+	// Probe and store into a table in the named shared-memory segment, created
+	// with the current size by the first process and joined (at its size) by the
+	// others. Entries are written lock-free, see entry::key16. An empty name
+	// returns to a private table; remove_shared unlinks the segment.
+	bool set_shared(const std::string& name);
+	const std::string& shared() const { return shared_name; }
+	static bool remove_shared(const std::string& name) { return Memory::unlink_shared(name); }
+};
+
+// Small per-thread, direct-mapped table (L2 sized) for shallow entries. It sits
+// in front of the shared hash_table: stores at depth <= shallow_depth stay here,
+// so near-leaf nodes neither thrash DRAM nor evict the deep entries the other
+// threads rely on. Probes look here first, then in the shared table.
+class tiered_table {
+private:
+	hash_table& shared;
+	std::unique_ptr<entry[]> slots;
+	size_t slot_count;
+	int shallow_depth;
+
+	inline entry* slot(const uint64& key) const;
+
+public:
+	// local_bytes == 0 disables the small table, everything goes to shared
+	tiered_table(hash_table& table, size_t local_bytes = 256 * 1024, int shallow = 2);
+
+	bool fetch(const uint64& key, hash_data& e);
+	void save(const uint64& key,
+		const uint8& depth,
+		const uint8& bound,
+		const Move& m,
+		const int16& score,
+		const int16& eval, const bool& pv_node);
+	void prefetch(const uint64& key) { shared.prefetch(key); }
+	bool mark_searching(const uint64& key, bool& overlap) { return shared.mark_searching(key, overlap); }
+	void clear_searching(const uint64& key) { shared.clear_searching(key); }
+	bool is_searching(const uint64& key) const { return shared.is_searching(key); }
 	void clear();
-	void resize(size_t sizeMb);
+	size_t local_bytes() const { return slot_count * sizeof(entry); }
 };
 
-inline entry* hash_table::first_entry(const U64& key) {
-	return &entries[key & (cluster_count - 1)].cluster_entries[0];
+inline entry* tiered_table::slot(const uint64& key) const {
+#if defined(_MSC_VER)
+	return &slots[__umulh(index_key(key), uint64(slot_count))];
+#else
+	__extension__ using uint128 = unsigned __int128;
+	return &slots[size_t(uint128(index_key(key)) * slot_count >> 64)];
+#endif
+}
+
+// On-disk header, padded to a page so the clusters can be mapped in place
+struct hash_file_header {
+	char magic[8];           // "NANOHASH"
+	uint32 version;          // file format
+	uint32 cluster_bytes;    // sizeof(hash_cluster)
+	uint64 cluster_count;
+	uint64 zobrist;          // Zobrist::fingerprint() of the writer
+	uint8 generation;        // of a shared segment: bumped in place by every attached process
+	uint8 pad[4096 - 33];
+};
+
+static_assert(sizeof(hash_file_header) == 4096, "the clusters must start page aligned");
+
+// Multiply-high maps the mixed key uniformly onto [0, cluster_count), so the
+// table can be any size.
+inline entry* hash_table::first_entry(const uint64& key) {
+#if defined(_MSC_VER)
+	const uint64 idx = __umulh(index_key(key), uint64(cluster_count));
+#else
+	__extension__ using uint128 = unsigned __int128;
+	const uint64 idx = uint64(uint128(index_key(key)) * cluster_count >> 64);
+#endif
+	return &entries[idx].cluster_entries[0];
+}
+
+inline void hash_table::prefetch(const uint64& key) {
+	_mm_prefetch(reinterpret_cast<const char*>(first_entry(key)), _MM_HINT_T0);
+}
+
+inline bool hash_table::mark_searching(const uint64& key, bool& overlap) {
+	uint64 expected = 0;
+	const uint64 tag = key | search_bit;
+	if (busy_slot(key).compare_exchange_strong(expected, tag, std::memory_order_relaxed)) {
+		overlap = false;
+		return true;
+	}
+	overlap = (expected == tag);
+	return false;
 }
 
 extern hash_table ttable; // global transposition table
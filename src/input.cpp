@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+#include "input.h"
+
+std::string Input::command(const std::string &line)
+{
+    std::istringstream ss(line);
+    std::string cmd;
+    ss >> cmd;
+    std::transform(cmd.begin(), cmd.end(), cmd.begin(), [](unsigned char c) { return char(std::tolower(c)); });
+    return cmd;
+}
+
+Input::Reader::Reader(std::istream &in, Handler urgent) : state_(std::make_shared<State>())
+{
+    thread_ = std::thread([&in, urgent = std::move(urgent), state = state_] {
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            const std::string cmd = command(line);
+            if (urgent && urgent(line))
+                continue;
+
+            std::lock_guard<std::mutex> lock(state->mtx);
+            state->lines.push_back(line);
+            state->cv.notify_one();
+            if (cmd == "quit" || cmd == "exit")
+                break;
+        }
+        std::lock_guard<std::mutex> lock(state->mtx);
+        state->done = true;
+        state->cv.notify_all();
+    });
+}
+
+Input::Reader::~Reader()
+{
+    bool done;
+    {
+        std::lock_guard<std::mutex> lock(state_->mtx);
+        done = state_->done;
+    }
+    // A thread still blocked reading cannot be interrupted portably, it keeps
+    // the state alive and exits with the process.
+    if (done)
+        thread_.join();
+    else
+        thread_.detach();
+}
+
+bool Input::Reader::next(std::string &line)
+{
+    std::unique_lock<std::mutex> lock(state_->mtx);
+    state_->waiting = true;
+    state_->cv.wait(lock, [&] { return !state_->lines.empty() || state_->done; });
+    state_->waiting = false;
+    if (state_->lines.empty())
+        return false;
+    line = std::move(state_->lines.front());
+    state_->lines.pop_front();
+    return true;
+}
+
+bool Input::Reader::poll(std::string &line)
+{
+    std::lock_guard<std::mutex> lock(state_->mtx);
+    if (state_->lines.empty())
+        return false;
+    line = std::move(state_->lines.front());
+    state_->lines.pop_front();
+    return true;
+}
+
+bool Input::Reader::idle() const
+{
+    std::lock_guard<std::mutex> lock(state_->mtx);
+    return state_->waiting && state_->lines.empty();
+}
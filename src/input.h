@@ -0,0 +1,62 @@
+#pragma once
+
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Input {
+
+    // First word of a command line, lower case
+    std::string command(const std::string &line);
+
+    // Reads command lines on a thread of its own, so the ones that cannot wait
+    // (stop, ponderhit, isready during a search) are acted on the moment they
+    // arrive, whatever the dispatching thread is busy with. urgent(line) runs on
+    // the reading thread and returns true when it has handled the line; every
+    // other line is queued for next(). Reading ends after "quit" or at the end
+    // of the input.
+    class Reader
+    {
+    public:
+        using Handler = std::function<bool(const std::string &)>;
+
+        Reader(std::istream &in, Handler urgent);
+        ~Reader();
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        // Blocks for the next queued line, false once input has ended and the
+        // queue is empty.
+        bool next(std::string &line);
+        bool poll(std::string &line); // never blocks
+
+        // No queued line and the dispatcher is back in next()
+        bool idle() const;
+
+    private:
+        // Shared with the reading thread, which may outlive the Reader while it
+        // is blocked in getline
+        struct State
+        {
+            mutable std::mutex mtx;
+            std::condition_variable cv;
+            std::deque<std::string> lines;
+            bool done = false;
+            bool waiting = false;
+        };
+
+        std::shared_ptr<State> state_;
+        std::thread thread_;
+    };
+}
+
+#endif
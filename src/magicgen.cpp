@@ -0,0 +1,235 @@
+
+// nano_magicgen: searches slider magics in parallel and regenerates magicsrands.h
+//
+//   nano_magicgen [--threads N] [--seconds S] [--out magicsrands.h]
+//
+// For every square the search keeps the magic with the shortest slice, the
+// highest used index + 1, over both the full mask width and one index bit
+// less (the current magic is the starting point, so a rerun never gets
+// worse). Slices are then packed into one table per piece, overlapping where
+// the entries of two squares agree or one of them is unused.
+// Each candidate and the final packed layout are checked exhaustively against
+// Magics::gen_attacks.
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bitboards.h"
+#include "bits.h"
+#include "magics.h"
+#include "magicsrands.h"
+#include "threads.h"
+#include "types.h"
+#include "utils.h"
+
+namespace
+{
+    struct SquareMagic
+    {
+        uint64 mask = 0ULL;
+        uint64 magic = 0ULL;
+        unsigned bits = 0;
+        std::vector<uint64> occupancy;
+        std::vector<uint64> atks;
+        std::vector<uint64> slice; // 2^bits entries, 0 for unused slots
+    };
+
+    // Fills slice for magic and trims its unused tail, returns false on a
+    // destructive collision
+    bool try_magic(SquareMagic &sm, const uint64 magic, const unsigned bits)
+    {
+        sm.slice.assign(size_t(1) << bits, 0ULL);
+        for (size_t i = 0; i < sm.occupancy.size(); ++i)
+        {
+            uint64 &slot = sm.slice[size_t(magic * sm.occupancy[i] >> (64 - bits))];
+            if (slot && slot != sm.atks[i])
+                return false;
+            slot = sm.atks[i];
+        }
+        while (!sm.slice.back())
+            sm.slice.pop_back();
+        sm.magic = magic;
+        sm.bits = bits;
+        return true;
+    }
+
+    // Keeps the valid magic with the shortest slice (highest used index + 1),
+    // trying both the full mask width and one index bit less.
+    void search_square(SquareMagic &sm, const PieceType_t p, const SquareType_t s,
+                       const uint64 current, const double seconds)
+    {
+        uint64 b = 0ULL;
+        do
+        {
+            sm.occupancy.push_back(b);
+            sm.atks.push_back(p == Piece::BISHOP ? Magics::gen_attacks<Piece::BISHOP>(b, s) : Magics::gen_attacks<Piece::ROOK>(b, s));
+            b = (b - sm.mask) & sm.mask;
+        } while (b);
+
+        const unsigned full = Bits::count(sm.mask);
+        SquareMagic best = sm;
+        bool have_best = try_magic(best, current, full);
+
+        Util::Rand<unsigned int> r;
+        Util::Clock clock;
+        clock.start();
+        do
+        {
+            for (int n = 0; n < 4096; ++n)
+            {
+                uint64 magic = Magics::next_magic(6, r) | Magics::next_magic(6, r);
+                if (Bits::count((magic * sm.mask) & 0xFF00000000000000ULL) < 6)
+                    continue;
+                for (unsigned bits = full - 1; bits <= full; ++bits)
+                {
+                    if (try_magic(sm, magic, bits) && (!have_best || sm.slice.size() < best.slice.size()))
+                    {
+                        best.slice.swap(sm.slice);
+                        best.magic = sm.magic;
+                        best.bits = sm.bits;
+                        have_best = true;
+                    }
+                }
+            }
+            clock.stop();
+        } while (clock.ms() < seconds * 1000.0 || !have_best);
+
+        sm.slice.swap(best.slice);
+        sm.magic = best.magic;
+        sm.bits = best.bits;
+    }
+
+    // First-fit packing in square order (neighbouring squares stay close): a slice
+    // may overlap the table wherever each slot is unused on one side or both agree.
+    std::vector<size_t> pack(const std::vector<SquareMagic> &sms, std::vector<uint64> &table)
+    {
+        std::vector<size_t> offsets(sms.size(), 0);
+
+        table.clear();
+        for (size_t s = 0; s < sms.size(); ++s)
+        {
+            const std::vector<uint64> &slice = sms[s].slice;
+            size_t o = 0;
+            for (;; ++o)
+            {
+                bool fits = true;
+                for (size_t i = 0; i < slice.size() && o + i < table.size() && fits; ++i)
+                    fits = !slice[i] || !table[o + i] || slice[i] == table[o + i];
+                if (fits)
+                    break;
+            }
+            if (table.size() < o + slice.size())
+                table.resize(o + slice.size(), 0ULL);
+            for (size_t i = 0; i < slice.size(); ++i)
+                if (slice[i])
+                    table[o + i] = slice[i];
+            offsets[s] = o;
+        }
+        return offsets;
+    }
+
+    bool verify(const std::vector<SquareMagic> &sms, const std::vector<size_t> &offsets,
+                const std::vector<uint64> &table)
+    {
+        for (size_t s = 0; s < sms.size(); ++s)
+            for (size_t i = 0; i < sms[s].occupancy.size(); ++i)
+                if (table[offsets[s] + size_t(sms[s].magic * sms[s].occupancy[i] >> (64 - sms[s].bits))] != sms[s].atks[i])
+                    return false;
+        return true;
+    }
+
+    template <typename T>
+    void write_array(std::ostream &os, const char *type, const char *name, const std::vector<T> &v, bool u64)
+    {
+        os << "    constexpr " << type << " " << name << "[64] =\n        {\n            ";
+        for (size_t i = 0; i < v.size(); ++i)
+        {
+            if (u64)
+                os << "U64(" << v[i] << ")";
+            else
+                os << v[i];
+            if (i + 1 < v.size())
+                os << ((i + 1) % (u64 ? 7 : 16) == 0 ? ",\n            " : ", ");
+        }
+        os << "\n        };\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    double seconds = 30.0;
+    std::string out = "magicsrands.h";
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (!strcmp(argv[i], "--threads"))
+            threads = std::max(1, atoi(argv[i + 1]));
+        else if (!strcmp(argv[i], "--seconds"))
+            seconds = atof(argv[i + 1]);
+        else if (!strcmp(argv[i], "--out"))
+            out = argv[i + 1];
+    }
+
+    std::vector<SquareMagic> sms[2] = {std::vector<SquareMagic>(64), std::vector<SquareMagic>(64)};
+    {
+        ThreadPool<WorkerThread> pool(threads);
+        TaskGroup squares;
+        for (PieceType_t p = Piece::BISHOP; p <= Piece::ROOK; ++p)
+        {
+            for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+            {
+                SquareMagic &sm = sms[p - Piece::BISHOP][s];
+                sm.mask = (p == Piece::BISHOP ? Bitboards::bishop_masks[s] : Bitboards::rook_masks[s]);
+                uint64 current = (p == Piece::BISHOP ? bishop_magics[s] : rook_magics[s]);
+                pool.enqueue(squares, search_square, std::ref(sm), p, s, current, seconds);
+            }
+        }
+        pool.wait(squares);
+    }
+
+    std::ofstream os(out);
+    os << "#pragma once\n\n#include \"types.h\"\n\n"
+       << "// Generated by nano_magicgen. Each square indexes table[offset + (magic * occ) >> shift];\n"
+       << "// slices of different squares may overlap where their entries agree.\n"
+       << "namespace\n{\n    #define U64(x) (static_cast<uint64_t>(x##ULL))\n";
+
+    for (PieceType_t p = Piece::BISHOP; p <= Piece::ROOK; ++p)
+    {
+        const char *name = (p == Piece::BISHOP ? "bishop" : "rook");
+        std::vector<SquareMagic> &v = sms[p - Piece::BISHOP];
+        std::vector<uint64> table;
+        std::vector<size_t> offsets = pack(v, table);
+        if (!verify(v, offsets, table))
+        {
+            std::cerr << "error: packed " << name << " table failed verification" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        size_t dense = 0;
+        std::vector<uint64> magics;
+        std::vector<unsigned> shifts;
+        for (auto &sm : v)
+        {
+            dense += size_t(1) << Bits::count(sm.mask);
+            magics.push_back(sm.magic);
+            shifts.push_back(64 - sm.bits);
+        }
+        std::cout << name << ": " << table.size() << " entries (" << table.size() * 8 / 1024 << " KB), dense layout "
+                  << dense << " entries (" << dense * 8 / 1024 << " KB)" << std::endl;
+
+        os << "\n    constexpr size_t " << name << "_table_size = " << table.size() << ";\n\n";
+        write_array(os, "uint64", (std::string(name) + "_magics").c_str(), magics, true);
+        os << "\n";
+        write_array(os, "unsigned", (std::string(name) + "_shifts").c_str(), shifts, false);
+        os << "\n";
+        write_array(os, "unsigned", (std::string(name) + "_offsets").c_str(), offsets, false);
+    }
+    os << "};\n";
+    std::cout << "wrote " << out << std::endl;
+    return EXIT_SUCCESS;
+}
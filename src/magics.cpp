@@ -1,28 +1,384 @@
 
 #include "magics.h"
 #include "magicsrands.h"
+#include "memory.h"
 #include "types.h"
 
+#include <bit>
+#include <cstring>
+#include <immintrin.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define NANO_TARGET_BMI2
+#define NANO_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define NANO_TARGET_BMI2 __attribute__((target("bmi2")))
+#define NANO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
 namespace Magics {
 namespace Detail {
 
+    // "Fancy" magic layout: every square owns a slice of one contiguous,
+    // cache-aligned table per piece type, and the attack bitboard is read with a
+    // single load at attacks[(magic * occ) >> shift]. Magics, shifts and slice
+    // offsets come from magicsrands.h (regenerate with nano_magicgen); slices of
+    // different squares may overlap where their entries agree.
+    // All tables below are constant expressions, generated by the compiler into
+    // read-only data, so there is nothing left to do at startup.
+    constexpr size_t BISHOP_TABLE_SIZE = bishop_table_size;
+    constexpr size_t ROOK_TABLE_SIZE = rook_table_size;
+
+    // pext tables are dense: 2^bits entries per square
+    constexpr size_t BISHOP_PEXT_SIZE = 5248;
+    constexpr size_t ROOK_PEXT_SIZE = 102400;
+
     struct Table
     {
+        const uint64 *attacks; // this square's slice of the magic-indexed table
+        const uint64 *pext;    // this square's slice of the pext-indexed table
         uint64 mask;
         uint64 magic;
-        uint16 offset;
-        uint8 shift;
-        inline unsigned entry(const uint64 &occ_) { return unsigned(magic * (mask & occ_) >> shift); }
+        unsigned shift;
+        constexpr unsigned entry(const uint64 &occ_) const { return unsigned(magic * (mask & occ_) >> shift); }
     };
-        std::vector<std::vector<uint8>> ridx(64, std::vector<uint8>(4096));
-        std::vector<std::vector<uint8>> bidx(64, std::vector<uint8>(512));
-        std::vector<uint64> battks;
-        std::vector<uint64> rattks;
-        Table rtable[64];
-        Table btable[64];
+
+    // Empty-board rays from every square: N, E, NE, NW (increasing squares)
+    // then S, W, SW, SE (decreasing squares).
+    constexpr int ray_dc[8] = {0, 1, 1, -1, 0, -1, -1, 1};
+    constexpr int ray_dr[8] = {1, 0, 1, 1, -1, 0, -1, -1};
+
+    constexpr auto rays = []
+    {
+        std::array<std::array<uint64, 64>, 8> r{};
+        for (int d = 0; d < 8; ++d)
+        {
+            for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+            {
+                int c = Util::col(s) + ray_dc[d];
+                int rw = Util::row(s) + ray_dr[d];
+                for (; c >= 0 && c < 8 && rw >= 0 && rw < 8; c += ray_dc[d], rw += ray_dr[d])
+                    r[d][s] |= 1ULL << (8 * rw + c);
+            }
+        }
+        return r;
+    }();
+
+    // Ray attacks stop at (and include) the nearest blocker in each direction.
+    constexpr uint64 ray_attacks(const uint64 occ, const SquareType_t s, const int d)
+    {
+        uint64 ray = rays[d][s];
+        uint64 blockers = ray & occ;
+        if (!blockers)
+            return ray;
+        int b = (d < 4 ? std::countr_zero(blockers) : 63 - std::countl_zero(blockers));
+        return ray ^ rays[d][b];
+    }
+
+    constexpr int rook_dirs[4] = {0, 1, 4, 5};
+    constexpr int bishop_dirs[4] = {2, 3, 6, 7};
+
+    constexpr uint64 slider_attacks(const PieceType_t p, const uint64 occ, const SquareType_t s)
+    {
+        uint64 bm = 0ULL;
+        for (int d : (p == Piece::ROOK ? rook_dirs : bishop_dirs))
+            bm |= ray_attacks(occ, s, d);
+        return bm;
+    }
+
+    // Relevant occupancy: the empty-board attacks minus the last square of each ray
+    constexpr uint64 slider_mask(const PieceType_t p, const SquareType_t s)
+    {
+        uint64 mask = 0ULL;
+        for (int d : (p == Piece::ROOK ? rook_dirs : bishop_dirs))
+        {
+            uint64 ray = rays[d][s];
+            if (ray)
+                ray ^= 1ULL << (d < 4 ? 63 - std::countl_zero(ray) : std::countr_zero(ray));
+            mask |= ray;
+        }
+        return mask;
+    }
+
+    template <size_t N, size_t PN>
+    struct SliderTables
+    {
+        std::array<uint64, N> attacks;
+        std::array<uint64, PN> pext;
+    };
+
+    template <PieceType_t p, size_t N, size_t PN>
+    constexpr SliderTables<N, PN> make_tables(const uint64 *magics, const unsigned *shifts, const unsigned *offsets)
+    {
+        SliderTables<N, PN> t{};
+        size_t pext_offset = 0;
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+        {
+            uint64 mask = slider_mask(p, s);
+            uint64 b = 0ULL;
+            size_t i = 0;
+
+            // enumerate all occupancy combinations of the bishop/rook mask. Carry-Rippler
+            // enumerates subsets in ascending order of their extracted bits, so the i-th
+            // subset b has pext(b, mask) == i.
+            do
+            {
+                uint64 atk = slider_attacks(p, b, s);
+                uint64 &slot = t.attacks[offsets[s] + unsigned(magics[s] * b >> shifts[s])];
+                if (slot && slot != atk)
+                    throw "destructive magic collision"; // not a constant expression: fails the build
+                slot = atk;
+                t.pext[pext_offset + i++] = atk;
+                b = (b - mask) & mask;
+            } while (b);
+
+            pext_offset += i;
+        }
+        if (pext_offset != PN)
+            throw "slider table size mismatch";
+        return t;
+    }
+
+    alignas(64) constexpr auto bishop = make_tables<Piece::BISHOP, BISHOP_TABLE_SIZE, BISHOP_PEXT_SIZE>(bishop_magics, bishop_shifts, bishop_offsets);
+    alignas(64) constexpr auto rook = make_tables<Piece::ROOK, ROOK_TABLE_SIZE, ROOK_PEXT_SIZE>(rook_magics, rook_shifts, rook_offsets);
+
+    // Per-square headers with pointers into the tables above
+    template <PieceType_t p, size_t N, size_t PN>
+    constexpr std::array<Table, 64> make_headers(const SliderTables<N, PN> &t, const uint64 *magics,
+                                                 const unsigned *shifts, const unsigned *offsets)
+    {
+        std::array<Table, 64> tab{};
+        size_t pext_offset = 0;
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+        {
+            tab[s].attacks = &t.attacks[offsets[s]];
+            tab[s].pext = &t.pext[pext_offset];
+            tab[s].mask = slider_mask(p, s);
+            tab[s].magic = magics[s];
+            tab[s].shift = shifts[s];
+            pext_offset += size_t(1) << std::popcount(tab[s].mask);
+        }
+        return tab;
+    }
+
+    constexpr std::array<Table, 64> bishop_headers = make_headers<Piece::BISHOP>(bishop, bishop_magics, bishop_shifts, bishop_offsets);
+    constexpr std::array<Table, 64> rook_headers = make_headers<Piece::ROOK>(rook, rook_magics, rook_shifts, rook_offsets);
+
+    // Runtime state: which index backend and fill path the host prefers, and the
+    // headers in use (constant initialized, repointed by set_huge_pages).
+    bool use_pext = fast_pext();
+    bool use_avx2 = has_avx2();
+    std::array<Table, 64> btable = bishop_headers;
+    std::array<Table, 64> rtable = rook_headers;
+    Memory::Block huge_block;
+
+    // Portable bit extract, used where the bmi2 instruction may be missing.
+    inline size_t pext_index(uint64 occ, uint64 mask)
+    {
+        size_t idx = 0;
+        for (unsigned bit = 0; mask; mask &= mask - 1, ++bit)
+            if (occ & mask & (0ULL - mask))
+                idx |= size_t(1) << bit;
+        return idx;
+    }
+
+    // Kept out of line so the bmi2 target only applies to the extract itself,
+    // the rest of the binary still runs on hosts without BMI2.
+    NANO_TARGET_BMI2 uint64 pext_attacks(const Table &t, const uint64 &occ)
+    {
+        return t.pext[_pext_u64(occ, t.mask)];
+    }
+
+    // Set-wise attacks by Kogge-Stone occluded fill: every slider in gen is
+    // flooded along a direction through empty squares in log2(7) = 3 steps,
+    // independent of how many sliders there are. wrap clears squares that
+    // wrapped around the a/h files.
+    constexpr uint64 NOT_A_FILE = 0xFEFEFEFEFEFEFEFEULL;
+    constexpr uint64 NOT_H_FILE = 0x7F7F7F7F7F7F7F7FULL;
+
+    struct FillDir
+    {
+        int step;
+        uint64 wrap;
+    };
+
+    constexpr FillDir rook_fill[4] = {{8, ~0ULL}, {-8, ~0ULL}, {1, NOT_A_FILE}, {-1, NOT_H_FILE}};
+    constexpr FillDir bishop_fill[4] = {{9, NOT_A_FILE}, {7, NOT_H_FILE}, {-7, NOT_A_FILE}, {-9, NOT_H_FILE}};
+
+    constexpr uint64 shift(const uint64 b, const int step) { return step > 0 ? b << step : b >> -step; }
+
+    constexpr uint64 fill_attacks(uint64 gen, const uint64 empty, const FillDir &d)
+    {
+        uint64 pro = empty & d.wrap;
+        gen |= pro & shift(gen, d.step);
+        pro &= shift(pro, d.step);
+        gen |= pro & shift(gen, 2 * d.step);
+        pro &= shift(pro, 2 * d.step);
+        gen |= pro & shift(gen, 4 * d.step);
+        return shift(gen, d.step) & d.wrap;
+    }
+
+    inline uint64 fill_attacks(const uint64 gen, const uint64 empty, const FillDir (&dirs)[4])
+    {
+        return fill_attacks(gen, empty, dirs[0]) | fill_attacks(gen, empty, dirs[1]) |
+               fill_attacks(gen, empty, dirs[2]) | fill_attacks(gen, empty, dirs[3]);
+    }
+
+    // AVX2 version: the 4 directions of a piece run in the 4 lanes of one
+    // register. Lanes shift left or right by a per-lane count; a count of 64
+    // yields 0, so shift(x) = sllv(x, left) | srlv(x, right) covers both.
+    struct alignas(32) FillLanes
+    {
+        int64_t left[3][4];  // counts for 1, 2 and 4 steps
+        int64_t right[3][4];
+        uint64 wrap[4];
+    };
+
+    constexpr FillLanes make_lanes(const FillDir (&dirs)[4])
+    {
+        FillLanes l{};
+        for (int k = 0; k < 3; ++k)
+        {
+            for (int d = 0; d < 4; ++d)
+            {
+                l.left[k][d] = dirs[d].step > 0 ? dirs[d].step << k : 64;
+                l.right[k][d] = dirs[d].step < 0 ? -dirs[d].step << k : 64;
+            }
+        }
+        for (int d = 0; d < 4; ++d)
+            l.wrap[d] = dirs[d].wrap;
+        return l;
+    }
+
+    constexpr FillLanes rook_lanes = make_lanes(rook_fill);
+    constexpr FillLanes bishop_lanes = make_lanes(bishop_fill);
+
+    NANO_TARGET_AVX2 inline __m256i shift_lanes(const __m256i x, const FillLanes &l, const int k)
+    {
+        return _mm256_or_si256(
+            _mm256_sllv_epi64(x, _mm256_load_si256(reinterpret_cast<const __m256i *>(l.left[k]))),
+            _mm256_srlv_epi64(x, _mm256_load_si256(reinterpret_cast<const __m256i *>(l.right[k]))));
+    }
+
+    NANO_TARGET_AVX2 inline __m256i fill_lanes(const uint64 gen, const uint64 empty, const FillLanes &l)
+    {
+        const __m256i wrap = _mm256_load_si256(reinterpret_cast<const __m256i *>(l.wrap));
+        __m256i g = _mm256_set1_epi64x(int64_t(gen));
+        __m256i pro = _mm256_and_si256(_mm256_set1_epi64x(int64_t(empty)), wrap);
+        g = _mm256_or_si256(g, _mm256_and_si256(pro, shift_lanes(g, l, 0)));
+        pro = _mm256_and_si256(pro, shift_lanes(pro, l, 0));
+        g = _mm256_or_si256(g, _mm256_and_si256(pro, shift_lanes(g, l, 1)));
+        pro = _mm256_and_si256(pro, shift_lanes(pro, l, 1));
+        g = _mm256_or_si256(g, _mm256_and_si256(pro, shift_lanes(g, l, 2)));
+        return _mm256_and_si256(shift_lanes(g, l, 0), wrap);
+    }
+
+    NANO_TARGET_AVX2 inline uint64 or_lanes(const __m256i x)
+    {
+        __m128i h = _mm_or_si128(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+        return uint64(_mm_cvtsi128_si64(h)) | uint64(_mm_extract_epi64(h, 1));
+    }
+
+    template <PieceType_t p>
+    NANO_TARGET_AVX2 uint64 fill_attacks_avx2(const uint64 occ, const uint64 pieces)
+    {
+        if constexpr (p == Piece::ROOK)
+            return or_lanes(fill_lanes(pieces, ~occ, rook_lanes));
+        else if constexpr (p == Piece::BISHOP)
+            return or_lanes(fill_lanes(pieces, ~occ, bishop_lanes));
+        else
+            return or_lanes(_mm256_or_si256(fill_lanes(pieces, ~occ, rook_lanes), fill_lanes(pieces, ~occ, bishop_lanes)));
+    }
+
+    template <PieceType_t p>
+    uint64 fill_attacks_scalar(const uint64 occ, const uint64 pieces)
+    {
+        if constexpr (p == Piece::ROOK)
+            return fill_attacks(pieces, ~occ, rook_fill);
+        else if constexpr (p == Piece::BISHOP)
+            return fill_attacks(pieces, ~occ, bishop_fill);
+        else
+            return fill_attacks(pieces, ~occ, rook_fill) | fill_attacks(pieces, ~occ, bishop_fill);
+    }
     } // end namespace detail
 }
 
+bool Magics::has_pext()
+{
+#ifdef _MSC_VER
+    int regs[4] = {};
+    __cpuidex(regs, 7, 0);
+    return (regs[1] >> 8) & 1;
+#else
+    unsigned int a = 0, b = 0, c = 0, d = 0;
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d))
+        return false;
+    return (b >> 8) & 1;
+#endif
+}
+
+bool Magics::fast_pext()
+{
+    if (!has_pext())
+        return false;
+
+    // Zen1/Zen2 (family 0x17) implement pext in microcode (~250 cycles),
+    // magics are the faster choice there.
+    unsigned int regs[4] = {};
+#ifdef _MSC_VER
+    __cpuid(reinterpret_cast<int *>(regs), 0);
+#else
+    __get_cpuid(0, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+    bool amd = regs[1] == 0x68747541; // "Auth"enticAMD
+    if (!amd)
+        return true;
+
+#ifdef _MSC_VER
+    __cpuid(reinterpret_cast<int *>(regs), 1);
+#else
+    __get_cpuid(1, &regs[0], &regs[1], &regs[2], &regs[3]);
+#endif
+    unsigned int family = ((regs[0] >> 8) & 0xF) + ((regs[0] >> 20) & 0xFF);
+    return family >= 0x19;
+}
+
+bool Magics::has_avx2()
+{
+#ifdef _MSC_VER
+    int regs[4] = {};
+    __cpuid(regs, 1);
+    bool osxsave = (regs[2] >> 27) & 1;
+    __cpuidex(regs, 7, 0);
+    return osxsave && ((regs[1] >> 5) & 1) && (_xgetbv(0) & 6) == 6;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool Magics::set_avx2(bool enabled)
+{
+    if (enabled && !has_avx2())
+        return false;
+    Detail::use_avx2 = enabled;
+    return true;
+}
+
+bool Magics::set_backend(Backend b)
+{
+    if (b == Backend::PEXT && !has_pext())
+        return false;
+    Detail::use_pext = (b == Backend::PEXT);
+    return true;
+}
+
+Magics::Backend Magics::backend()
+{
+    return Detail::use_pext ? Backend::PEXT : Backend::MAGIC;
+}
+
 uint64 Magics::next_magic(const unsigned int &bits, Util::Rand<unsigned int> &r)
 {
     uint64 res = 0ULL;
@@ -64,152 +420,88 @@ uint64 Magics::gen_attacks(const uint64 &occ, const SquareType_t &s)
     return bm;
 }
 
-bool Magics::load() {
-    std::vector<uint64> occupancy, atks, used;
-    occupancy.reserve(4096);
-    atks.reserve(4096);
-    used.reserve(4096);
-    occupancy.resize(4096);
-    atks.resize(4096);
-    used.resize(4096);
-    Util::Rand<unsigned int> r;
-
-    // 4096 is computed from counting the number of possible blockers for a rook/bishop at a given square.
-    // E.g. the rook@A1 has 12 squares which can be blocked (A8,H1 have been removed)
-    // in mathematica : sum[12!/(n!*(12-n)!),{n,1,12}] = 4095 .. similar computation for bishop@E4.
-    Detail::battks.reserve(1428);
-    Detail::battks.resize(1428);
-    Detail::rattks.reserve(4900);
-    Detail::rattks.resize(4900);
-
-    // structs to provide shorthand indexing
-    struct _attks
-    {
-        std::vector<uint64> &operator[](const int &idx) { return (idx == 2 ? Detail::battks : Detail::rattks); }
-    };
-    struct _idx
-    {
-        std::vector<std::vector<uint8>> &operator[](const int &idx) { return (idx == 2 ? Detail::bidx : Detail::ridx); }
-    };
-    _attks attack_arr;
-    _idx indices;
-
-    // these offsets tally the number of unique attack arrays
-    // that exist for bishop/rook at the given square. E.g. all values
-    // for the rook can be computed by
-    // value = empty_row1_sqs * empty_row2_sqs * empty_col1_sqs * empty_col2_sqs
-    // rook@A1 has 49 unique attack patterns (but 4096 occupancies at A1)
-    std::vector<std::vector<int>> offsets =
-        {
-            {}, // pawn
-            {}, // knight
-            { 
-                7, 6, 10, 12, 12, 10, 6, 7,
-                6, 6, 10, 12, 12, 10, 6, 6,
-                10, 10, 40, 48, 48, 40, 10, 10,
-                12, 12, 48, 108, 108, 48, 12, 12,
-                12, 12, 48, 108, 108, 48, 12, 12,
-                10, 10, 40, 48, 48, 40, 10, 10,
-                6, 6, 10, 12, 12, 10, 6, 6,
-                7, 6, 10, 12, 12, 10, 6, 7},
-            {
-                49, 42, 70, 84, 84, 70, 42, 49,
-                42, 36, 60, 72, 72, 60, 36, 42,
-                70, 60, 100, 120, 120, 100, 60, 70,
-                84, 72, 120, 144, 144, 120, 72, 84,
-                84, 72, 120, 144, 144, 120, 72, 84,
-                70, 60, 100, 120, 120, 100, 60, 70,
-                42, 36, 60, 72, 72, 60, 36, 42,
-                49, 42, 70, 84, 84, 70, 42, 49
-            }
-        };
-
-    for (PieceType_t p = Piece::BISHOP; p <= Piece::ROOK; ++p)
-    {
-        constexpr size_t bits = 6;
-        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
-        {
-
-            uint64 mask = (p == Piece::ROOK ? Bitboards::rook_masks[s] : Bitboards::bishop_masks[s]);
-            uint8 shift = 64 - Bits::count(mask);
-            uint64 b = 0ULL;
-            int occ_size = 0;
-            uint64 magic = 0ULL;
-            uint64 filter = 0ULL;
-
-            // enumerate all occupancy combinations of the bishop/rook mask
-            do
-            {
-                occupancy[occ_size] = b;
-                atks[occ_size++] = (p == Piece::BISHOP ? gen_attacks<Piece::BISHOP>(b, s) : gen_attacks<Piece::ROOK>(b, s));
-                b = (b - mask) & mask;
-            } while (b);
+template uint64 Magics::gen_attacks<Piece::BISHOP>(const uint64 &occ, const SquareType_t &s);
+template uint64 Magics::gen_attacks<Piece::ROOK>(const uint64 &occ, const SquareType_t &s);
 
-            int count = 0;
-            // do {
-
-            //  do {
-            //    magic = next_magic(bits, r);
-            //    filter = (magic * mask) & 0xFFFF000000000000;
-            //  } while (bits::count(filter) < 7);
+// Tables are compile-time constants, kept so callers need not know.
+bool Magics::load() {
+    return true;
+}
 
-            //  used.assign(occ_size, 0);
+bool Magics::set_huge_pages(bool enabled)
+{
+    using namespace Detail;
+    btable = bishop_headers;
+    rtable = rook_headers;
+    Memory::release(huge_block);
+    if (!enabled)
+        return true;
 
-            //  for (count = 0; count < occ_size; ++count) {
-            //    unsigned int idx = unsigned(magic * (mask & occupancy[count]) >> shift);
+    // both pieces and both backends, about 1.7 MB: a single 2 MB page
+    const size_t rook_at = (sizeof(bishop) + 63) / 64 * 64;
+    huge_block = Memory::alloc(rook_at + sizeof(rook), true);
+    if (huge_block.pages == Memory::Pages::NORMAL)
+    {
+        Memory::release(huge_block); // no gain over the tables in read-only data
+        return false;
+    }
 
-            //    if ((used[idx] == 0ULL &&
-            //      (used[idx] != occupancy[count] ||
-            //        occupancy[count] == 0ULL))) used[idx] = occupancy[count];
-            //    else break;
-            //  }
-            //} while (count != occ_size);
+    char *base = static_cast<char *>(huge_block.ptr);
+    std::memcpy(base, &bishop, sizeof(bishop));
+    std::memcpy(base + rook_at, &rook, sizeof(rook));
 
-            // remove redundant occupancies
-            uint16 offset = 0;
-            magic = (p == Piece::BISHOP ? bishop_magics[s] : rook_magics[s]);
+    auto relocate = [](const uint64 *p, const void *from, char *to)
+    { return reinterpret_cast<const uint64 *>(to + (reinterpret_cast<const char *>(p) - static_cast<const char *>(from))); };
+    for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+    {
+        btable[s].attacks = relocate(btable[s].attacks, &bishop, base);
+        btable[s].pext = relocate(btable[s].pext, &bishop, base);
+        rtable[s].attacks = relocate(rtable[s].attacks, &rook, base + rook_at);
+        rtable[s].pext = relocate(rtable[s].pext, &rook, base + rook_at);
+    }
+    return true;
+}
 
-            for (int i = 0; i < s; ++i)
-                offset += offsets[p][i];
+std::string Magics::page_info()
+{
+    if (!Detail::huge_block.ptr)
+        return "read-only data";
+    return Memory::describe(Detail::huge_block);
+}
 
-            uint64 stored[64][144] = {{}};
+size_t Magics::table_bytes(Backend b)
+{
+    if (b == Backend::PEXT)
+        return sizeof(Detail::bishop.pext) + sizeof(Detail::rook.pext);
+    return sizeof(Detail::bishop.attacks) + sizeof(Detail::rook.attacks);
+}
 
-            // filter those occupancies which are redundant, the index : r_occ[s][idx] + offset
-            for (int i = 0; i < occ_size; ++i)
+size_t Magics::lines_touched(Backend b, const uint64 *occs, size_t n)
+{
+    std::vector<const uint64 *> lines;
+    lines.reserve(n * 128);
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+        {
+            const Detail::Table &bt = Detail::btable[s];
+            const Detail::Table &rt = Detail::rtable[s];
+            if (b == Backend::PEXT)
+            {
+                lines.push_back(&bt.pext[Detail::pext_index(occs[i], bt.mask)]);
+                lines.push_back(&rt.pext[Detail::pext_index(occs[i], rt.mask)]);
+            }
+            else
             {
-                unsigned int idx = unsigned(magic * (mask & occupancy[i]) >> shift);
-                uint64 atk = atks[i];
-
-                int k = 0;
-                while (k < 144)
-                {
-                    uint64 prev = stored[s][k];
-                    if (!prev && prev != atk)
-                    {
-                        stored[s][k] = atk;
-                        break;
-                    }
-                    else if (prev == atk)
-                        break;
-                    ++k;
-                }
-                indices[p][s][idx] = k;
-
-                int o = indices[p][s][idx] + offset; // total offset
-                attack_arr[p][o] = atks[i];
-                Detail::Table *tab = (p == Piece::BISHOP ? Detail::btable : Detail::rtable);
-                tab[s].magic = magic;
-                tab[s].mask = mask;
-                tab[s].shift = shift;
-                tab[s].offset = offset;
+                lines.push_back(&bt.attacks[bt.entry(occs[i])]);
+                lines.push_back(&rt.attacks[rt.entry(occs[i])]);
             }
-            // std::cout << "s " << s <<  "occ size: " << occ_size << std::endl;
-            // std::string eol = (s % 6 != 0 ? "), " : "),\n");
-            // std::cout << "uint64(" << magic << eol;
-            // if (s == 63) std::cout << "==============================" << std::endl;
         }
     }
-    return true;
+    for (auto &l : lines)
+        l = reinterpret_cast<const uint64 *>(reinterpret_cast<uintptr_t>(l) & ~uintptr_t(63));
+    std::sort(lines.begin(), lines.end());
+    return size_t(std::unique(lines.begin(), lines.end()) - lines.begin());
 }
 
 namespace Magics
@@ -218,13 +510,54 @@ namespace Magics
     uint64 attacks<Piece::ROOK>(const uint64 &occ, const SquareType_t &s)
     {
         using namespace Detail;
-        return rattks[ridx[s][rtable[s].entry(occ)] + rtable[s].offset];
+        if (use_pext)
+            return pext_attacks(rtable[s], occ);
+        return rtable[s].attacks[rtable[s].entry(occ)];
     }
 
     template <>
     uint64 attacks<Piece::BISHOP>(const uint64 &occ, const SquareType_t &s)
     {
         using namespace Detail;
-        return battks[bidx[s][btable[s].entry(occ)] + btable[s].offset];
+        if (use_pext)
+            return pext_attacks(btable[s], occ);
+        return btable[s].attacks[btable[s].entry(occ)];
     }
-}
\ No newline at end of file
+
+    // Both lookups behind a single backend check
+    template <>
+    uint64 attacks<Piece::QUEEN>(const uint64 &occ, const SquareType_t &s)
+    {
+        using namespace Detail;
+        if (use_pext)
+            return pext_attacks(rtable[s], occ) | pext_attacks(btable[s], occ);
+        return rtable[s].attacks[rtable[s].entry(occ)] | btable[s].attacks[btable[s].entry(occ)];
+    }
+
+    // Attacks behind the first blockers hit: removing them only changes the rays
+    // they sit on, so the difference of the two lookups is the x-ray set.
+    template <PieceType_t p>
+    uint64 xray_attacks(const uint64 &occ, const uint64 &blockers, const SquareType_t &s)
+    {
+        static_assert(p == Piece::BISHOP || p == Piece::ROOK || p == Piece::QUEEN);
+        const uint64 atks = attacks<p>(occ, s);
+        return atks ^ attacks<p>(occ ^ (blockers & atks), s);
+    }
+
+    template uint64 xray_attacks<Piece::BISHOP>(const uint64 &occ, const uint64 &blockers, const SquareType_t &s);
+    template uint64 xray_attacks<Piece::ROOK>(const uint64 &occ, const uint64 &blockers, const SquareType_t &s);
+    template uint64 xray_attacks<Piece::QUEEN>(const uint64 &occ, const uint64 &blockers, const SquareType_t &s);
+
+    template <PieceType_t p>
+    uint64 attacks_all(const uint64 &occ, const uint64 &pieces)
+    {
+        static_assert(p == Piece::BISHOP || p == Piece::ROOK || p == Piece::QUEEN);
+        if (Detail::use_avx2)
+            return Detail::fill_attacks_avx2<p>(occ, pieces);
+        return Detail::fill_attacks_scalar<p>(occ, pieces);
+    }
+
+    template uint64 attacks_all<Piece::BISHOP>(const uint64 &occ, const uint64 &pieces);
+    template uint64 attacks_all<Piece::ROOK>(const uint64 &occ, const uint64 &pieces);
+    template uint64 attacks_all<Piece::QUEEN>(const uint64 &occ, const uint64 &pieces);
+}
@@ -13,15 +13,47 @@
 
 namespace Magics {
 
+    // Slider index backends: magic multiply/shift or BMI2 parallel bit extract.
+    enum class Backend { MAGIC, PEXT };
+
     template <PieceType_t p>
     uint64 gen_attacks(const uint64 &occ, const SquareType_t &s);
 
     template <PieceType_t p>
-    uint64 attacks(const uint64 &occ, const SquareType_t &s);
+    uint64 attacks(const uint64 &occ, const SquareType_t &s); // bishop, rook or queen
+
+    // Squares attacked through the blockers (a subset of occ) that the slider on s
+    // hits first, e.g. with blockers = own pieces for pins and discovered checks.
+    template <PieceType_t p>
+    uint64 xray_attacks(const uint64 &occ, const uint64 &blockers, const SquareType_t &s);
+
+    // Union of the attacks of every bishop, rook or queen in pieces (set-wise fill,
+    // AVX2 when available), e.g. attacks_all<Piece::ROOK>(occ, rooks | queens).
+    template <PieceType_t p>
+    uint64 attacks_all(const uint64 &occ, const uint64 &pieces);
 
     uint64 next_magic(const unsigned int &bits, Util::Rand<unsigned int> &r);
 
     bool load();
+
+    bool has_pext();
+    bool fast_pext();
+    bool set_backend(Backend b);
+    Backend backend();
+
+    bool has_avx2();
+    bool set_avx2(bool enabled);
+
+    // Copies the slider tables into huge pages (one TLB entry instead of a few
+    // hundred), false on failure or when disabled: lookups then read the
+    // compile-time tables. Not safe while other threads are probing.
+    bool set_huge_pages(bool enabled);
+    std::string page_info();
+
+    // Diagnostics: bytes of the lookup tables, and how many distinct 64-byte
+    // lines n occupancies touch when every square is probed for both sliders.
+    size_t table_bytes(Backend b);
+    size_t lines_touched(Backend b, const uint64 *occs, size_t n);
 }
 
 #endif
@@ -0,0 +1,295 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "memory.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace
+{
+    constexpr size_t KB = 1024;
+    constexpr size_t MB = 1024 * KB;
+    constexpr size_t GB = 1024 * MB;
+
+    constexpr size_t round_up(size_t x, size_t to) { return (x + to - 1) / to * to; }
+
+    size_t normal_page_size()
+    {
+#if defined(__linux__)
+        return size_t(sysconf(_SC_PAGESIZE));
+#else
+        return 4 * KB;
+#endif
+    }
+
+    Memory::Block heap_alloc(size_t bytes)
+    {
+        Memory::Block b;
+        b.bytes = round_up(bytes, 64);
+#if defined(_WIN32)
+        b.ptr = _aligned_malloc(b.bytes, 64);
+#else
+        b.ptr = std::aligned_alloc(64, b.bytes);
+#endif
+        if (!b.ptr)
+            return Memory::Block{};
+        return b;
+    }
+
+#if defined(__linux__)
+    Memory::Block hugetlb_alloc(size_t bytes, size_t page, int flag, Memory::Pages pages)
+    {
+        Memory::Block b;
+        b.bytes = round_up(bytes, page);
+        void *p = mmap(nullptr, b.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | flag, -1, 0);
+        if (p == MAP_FAILED)
+            return Memory::Block{};
+        b.ptr = p;
+        b.pages = pages;
+        b.mapped = true;
+        return b;
+    }
+
+    // Over-map by 2 MB, trim to a 2 MB aligned range and let khugepaged / the
+    // fault handler back it with huge pages.
+    Memory::Block thp_alloc(size_t bytes)
+    {
+        Memory::Block b;
+        b.bytes = round_up(bytes, 2 * MB);
+        size_t mapped = b.bytes + 2 * MB;
+        void *p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return Memory::Block{};
+
+        char *base = static_cast<char *>(p);
+        char *aligned = reinterpret_cast<char *>(round_up(reinterpret_cast<uintptr_t>(base), 2 * MB));
+        if (aligned > base)
+            munmap(base, size_t(aligned - base));
+        if (aligned + b.bytes < base + mapped)
+            munmap(aligned + b.bytes, size_t(base + mapped - aligned - b.bytes));
+
+        b.ptr = aligned;
+        b.mapped = true;
+        b.pages = (madvise(aligned, b.bytes, MADV_HUGEPAGE) == 0 ? Memory::Pages::TRANSPARENT_HUGE : Memory::Pages::NORMAL);
+        return b;
+    }
+#endif
+
+    std::string size_str(size_t bytes)
+    {
+        std::ostringstream ss;
+        if (bytes >= GB && bytes % GB == 0)
+            ss << bytes / GB << " GB";
+        else if (bytes >= MB)
+            ss << bytes / MB << " MB";
+        else
+            ss << bytes / KB << " KB";
+        return ss.str();
+    }
+}
+
+Memory::Block Memory::alloc(size_t bytes, bool huge_pages)
+{
+    if (!bytes)
+        return Block{};
+
+#if defined(__linux__)
+    if (huge_pages)
+    {
+        Block b;
+        if (bytes >= GB)
+            b = hugetlb_alloc(bytes, GB, MAP_HUGE_1GB, Pages::HUGE_1GB);
+        if (!b.ptr)
+            b = hugetlb_alloc(bytes, 2 * MB, MAP_HUGE_2MB, Pages::HUGE_2MB);
+        if (!b.ptr)
+            b = thp_alloc(bytes);
+        if (b.ptr)
+            return b;
+    }
+#elif defined(_WIN32)
+    // Large pages need the "Lock pages in memory" privilege, without it the
+    // call fails and we fall back to the heap.
+    if (huge_pages && GetLargePageMinimum())
+    {
+        Block b;
+        b.bytes = round_up(bytes, GetLargePageMinimum());
+        b.ptr = VirtualAlloc(nullptr, b.bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+        b.pages = Pages::HUGE_2MB;
+        b.mapped = true;
+        if (b.ptr)
+            return b;
+    }
+#endif
+    return heap_alloc(bytes);
+}
+
+Memory::Block Memory::map_file(const std::string &path, size_t offset, size_t bytes)
+{
+    Block b;
+#if defined(__linux__)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return b;
+    void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, off_t(offset));
+    close(fd); // the mapping keeps the file referenced
+    if (p == MAP_FAILED)
+        return b;
+    b.ptr = p;
+    b.bytes = bytes;
+    b.pages = Pages::FILE_MAPPED;
+    b.mapped = true;
+#else
+    (void)path;
+    (void)offset;
+    (void)bytes;
+#endif
+    return b;
+}
+
+Memory::Block Memory::map_shared(const std::string &name, size_t bytes, bool &created)
+{
+    Block b;
+    created = false;
+#if defined(__linux__)
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd >= 0)
+    {
+        created = true;
+        if (ftruncate(fd, off_t(bytes)) != 0)
+        {
+            close(fd);
+            shm_unlink(name.c_str());
+            return b;
+        }
+    }
+    else
+    {
+        fd = shm_open(name.c_str(), O_RDWR, 0600);
+        if (fd < 0)
+            return b;
+
+        // the creator may not have sized it yet
+        struct stat st = {};
+        for (int i = 0; i < 1000 && fstat(fd, &st) == 0 && st.st_size == 0; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        bytes = size_t(st.st_size);
+    }
+
+    void *p = bytes ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (p == MAP_FAILED)
+        return b;
+    b.ptr = p;
+    b.bytes = bytes;
+    b.pages = Pages::SHARED;
+    b.mapped = true;
+#else
+    (void)name;
+    (void)bytes;
+#endif
+    return b;
+}
+
+bool Memory::unlink_shared(const std::string &name)
+{
+#if defined(__linux__)
+    return shm_unlink(name.c_str()) == 0;
+#else
+    (void)name;
+    return false;
+#endif
+}
+
+void Memory::release(Block &b)
+{
+    if (!b.ptr)
+        return;
+#if defined(__linux__)
+    if (b.mapped)
+        munmap(b.ptr, b.bytes);
+    else
+        std::free(b.ptr);
+#elif defined(_WIN32)
+    if (b.mapped)
+        VirtualFree(b.ptr, 0, MEM_RELEASE);
+    else
+        _aligned_free(b.ptr);
+#else
+    std::free(b.ptr);
+#endif
+    b = Block{};
+}
+
+size_t Memory::huge_bytes(const Block &b)
+{
+    if (b.pages == Pages::HUGE_2MB || b.pages == Pages::HUGE_1GB)
+        return b.bytes;
+
+#if defined(__linux__)
+    if (b.pages == Pages::TRANSPARENT_HUGE)
+    {
+        // Sum AnonHugePages of the mappings inside [ptr, ptr + bytes); the kernel
+        // may have split or merged our range with its neighbours.
+        std::ifstream smaps("/proc/self/smaps");
+        const uintptr_t lo = reinterpret_cast<uintptr_t>(b.ptr), hi = lo + b.bytes;
+        bool inside = false;
+        size_t total = 0;
+        std::string line;
+        while (std::getline(smaps, line))
+        {
+            unsigned long long start, end;
+            if (std::sscanf(line.c_str(), "%llx-%llx ", &start, &end) == 2 && line.find('-') < line.find(' '))
+                inside = (start < hi && end > lo);
+            else if (inside && line.compare(0, 14, "AnonHugePages:") == 0)
+                total += size_t(std::strtoull(line.c_str() + 14, nullptr, 10)) * KB;
+        }
+        return total;
+    }
+#endif
+    return 0;
+}
+
+std::string Memory::describe(const Block &b)
+{
+    if (!b.ptr)
+        return "not allocated";
+
+    if (b.pages == Pages::FILE_MAPPED)
+        return size_str(b.bytes) + " mapped from file";
+    if (b.pages == Pages::SHARED)
+        return size_str(b.bytes) + " shared memory";
+
+    std::string s = size_str(b.bytes) + " on ";
+    switch (b.pages)
+    {
+    case Pages::HUGE_1GB:
+        return s + "1 GB pages";
+    case Pages::HUGE_2MB:
+        return s + "2 MB pages";
+    case Pages::TRANSPARENT_HUGE:
+        return s + size_str(normal_page_size()) + " pages, " + size_str(huge_bytes(b)) + " transparent huge pages";
+    default:
+        return s + size_str(normal_page_size()) + " pages";
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+#include <cstddef>
+#include <string>
+
+namespace Memory {
+
+    // Page size a large block ended up on.
+    enum class Pages { NORMAL, TRANSPARENT_HUGE, HUGE_2MB, HUGE_1GB, FILE_MAPPED, SHARED };
+
+    struct Block
+    {
+        void *ptr = nullptr;
+        size_t bytes = 0; // usable (and mapped) size, rounded up to the page size
+        Pages pages = Pages::NORMAL;
+        bool mapped = false; // mmap/VirtualAlloc rather than the heap
+    };
+
+    // At least cache line aligned. Mapped blocks are zero filled; a heap block is
+    // not, its pages are left for the owner to touch first (the hash table
+    // zeroes it from the search threads). With huge_pages the block is taken
+    // from explicit 1 GB or 2 MB huge pages (MAP_HUGETLB) when the system has them
+    // reserved, else from a 2 MB aligned mapping advised for transparent huge pages,
+    // else from normal pages. Returns an empty block when out of memory.
+    Block alloc(size_t bytes, bool huge_pages);
+    void release(Block &b);
+
+    // Private, copy-on-write mapping of bytes of path starting at offset (a
+    // multiple of the page size): pages are read in lazily on first touch and
+    // writes never reach the file. Returns an empty block on failure.
+    Block map_file(const std::string &path, size_t offset, size_t bytes);
+
+    // Maps the named POSIX shared-memory segment, creating it with bytes (zero
+    // filled) if it does not exist yet; otherwise the block has the segment's
+    // size. created tells which of the two happened.
+    Block map_shared(const std::string &name, size_t bytes, bool &created);
+    bool unlink_shared(const std::string &name);
+
+    // Bytes of b actually backed by huge pages (for transparent huge pages the
+    // kernel decides per 2 MB region on first touch).
+    size_t huge_bytes(const Block &b);
+
+    // e.g. "128 MB on 2 MB pages" or "128 MB on 4 KB pages, 126 MB transparent huge pages"
+    std::string describe(const Block &b);
+}
+
+#endif
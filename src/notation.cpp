@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+
+#include "notation.h"
+#include "zobrist.h"
+
+namespace
+{
+    bool parse_square(char file, char rank, uint8 &sq)
+    {
+        if (file < 'a' || file > 'h' || rank < '1' || rank > '8')
+            return false;
+        sq = uint8((rank - '1') * 8 + (file - 'a'));
+        return true;
+    }
+
+    PieceType_t piece_of(char c)
+    {
+        switch (c | 0x20)
+        {
+        case 'p': return Piece::PAWN;
+        case 'n': return Piece::KNIGHT;
+        case 'b': return Piece::BISHOP;
+        case 'r': return Piece::ROOK;
+        case 'q': return Piece::QUEEN;
+        case 'k': return Piece::KING;
+        default: return Piece::NONE;
+        }
+    }
+
+    bool clock(const std::string &s, int lo, int &v)
+    {
+        char *end = nullptr;
+        long n = std::strtol(s.c_str(), &end, 10);
+        if (s.empty() || *end != '\0' || n < lo || n > 100000)
+            return false;
+        v = int(n);
+        return true;
+    }
+}
+
+bool Notation::parse_move(std::string_view s, UciMove &m)
+{
+    if (s.size() != 4 && s.size() != 5)
+        return false;
+    if (!parse_square(s[0], s[1], m.from) || !parse_square(s[2], s[3], m.to) || m.from == m.to)
+        return false;
+
+    m.promote = Piece::NONE;
+    if (s.size() == 5)
+    {
+        switch (s[4] | 0x20) // some GUIs send "e7e8Q"
+        {
+        case 'q': m.promote = Piece::QUEEN; break;
+        case 'r': m.promote = Piece::ROOK; break;
+        case 'b': m.promote = Piece::BISHOP; break;
+        case 'n': m.promote = Piece::KNIGHT; break;
+        default: return false;
+        }
+    }
+    return true;
+}
+
+std::string Notation::to_string(const UciMove &m)
+{
+    std::string s = std::string(SanSquares[m.from]) + SanSquares[m.to];
+    switch (m.promote)
+    {
+    case Piece::QUEEN: return s + "q";
+    case Piece::ROOK: return s + "r";
+    case Piece::BISHOP: return s + "b";
+    case Piece::KNIGHT: return s + "n";
+    default: return s;
+    }
+}
+
+bool Notation::parse_fen(const std::string &s, Fen &fen)
+{
+    std::istringstream ss(s);
+    std::string board, side, castling = "-", ep = "-", half, full;
+    if (!(ss >> board >> side) || (side != "w" && side != "b"))
+        return false;
+    ss >> castling >> ep >> half >> full;
+
+    std::fill(std::begin(fen.piece), std::end(fen.piece), Piece::NONE);
+    std::fill(std::begin(fen.color), std::end(fen.color), Color::WHITE);
+    int rank = 7, file = 0, kings[2] = {0, 0};
+    for (char c : board)
+    {
+        if (c == '/')
+        {
+            if (file != 8 || rank == 0)
+                return false;
+            --rank;
+            file = 0;
+        }
+        else if (c >= '1' && c <= '8')
+            file += c - '0';
+        else
+        {
+            const PieceType_t p = piece_of(c);
+            if (p == Piece::NONE || file > 7)
+                return false;
+            const ColorType_t color = (c >= 'a' ? Color::BLACK : Color::WHITE);
+            kings[color] += (p == Piece::KING);
+            fen.piece[rank * 8 + file] = p;
+            fen.color[rank * 8 + file] = color;
+            ++file;
+        }
+        if (file > 8)
+            return false;
+    }
+    if (rank != 0 || file != 8 || kings[Color::WHITE] != 1 || kings[Color::BLACK] != 1)
+        return false;
+    fen.side = (side == "w" ? Color::WHITE : Color::BLACK);
+
+    fen.castling[Color::WHITE] = fen.castling[Color::BLACK] = 0;
+    for (char c : castling)
+    {
+        switch (c)
+        {
+        case 'K': fen.castling[Color::WHITE] |= 1; break;
+        case 'Q': fen.castling[Color::WHITE] |= 2; break;
+        case 'k': fen.castling[Color::BLACK] |= 1; break;
+        case 'q': fen.castling[Color::BLACK] |= 2; break;
+        case '-': break;
+        default: return false;
+        }
+    }
+
+    uint8 sq = 0;
+    fen.ep_file = -1;
+    if (ep != "-")
+    {
+        if (ep.size() != 2 || !parse_square(ep[0], ep[1], sq))
+            return false;
+        fen.ep_file = sq & 7;
+    }
+
+    fen.halfmove = 0;
+    fen.fullmove = 1;
+    return (half.empty() || clock(half, 0, fen.halfmove)) && (full.empty() || clock(full, 1, fen.fullmove));
+}
+
+uint64 Notation::key(const Fen &fen)
+{
+    uint64 k = 0;
+    for (int sq = 0; sq < 64; ++sq)
+        if (fen.piece[sq] != Piece::NONE)
+            k ^= Zobrist::piece(sq, fen.color[sq], fen.piece[sq]);
+    k ^= Zobrist::castle(Color::WHITE, fen.castling[Color::WHITE]) ^ Zobrist::castle(Color::BLACK, fen.castling[Color::BLACK]);
+    if (fen.ep_file >= 0)
+        k ^= Zobrist::en_passant(uint8(fen.ep_file));
+    return k ^ Zobrist::side_to_move(fen.side);
+}
+
+bool Notation::parse_position(const std::string &args, PositionCommand &cmd)
+{
+    std::istringstream ss(args);
+    std::string token;
+    cmd.start.clear();
+    cmd.moves.clear();
+
+    if (!(ss >> token))
+        return false;
+    if (token == "startpos")
+        cmd.start = token;
+    else if (token == "fen")
+    {
+        while (ss >> token && token != "moves")
+            cmd.start += (cmd.start.empty() ? "" : " ") + token;
+        if (cmd.start.empty())
+            return false;
+        if (token != "moves")
+            return true;
+    }
+    else
+        return false;
+
+    if (cmd.start == "startpos" && !(ss >> token && token == "moves"))
+        return true;
+    while (ss >> token)
+        cmd.moves.push_back(token);
+    return true;
+}
+
+int Notation::resume_from(const PositionCommand &prev, const PositionCommand &next)
+{
+    if (prev.start.empty() || prev.start != next.start || prev.moves.size() > next.moves.size())
+        return -1;
+    if (!std::equal(prev.moves.begin(), prev.moves.end(), next.moves.begin()))
+        return -1;
+    return int(prev.moves.size());
+}
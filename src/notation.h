@@ -0,0 +1,66 @@
+#pragma once
+
+#ifndef NOTATION_H_
+#define NOTATION_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "types.h"
+
+namespace Notation
+{
+    // A move in UCI long algebraic notation, e.g. "e2e4", "e1g1" or "e7e8q"
+    struct UciMove
+    {
+        uint8 from = 0;
+        uint8 to = 0;
+        PieceType_t promote = Piece::NONE;
+
+        bool operator==(const UciMove &other) const { return from == other.from && to == other.to && promote == other.promote; }
+    };
+
+    // Reads the squares and promotion piece straight from the text, without
+    // generating moves; false if s is not of that form. Whether the move is
+    // legal (and its MoveType) is up to the position it is played in.
+    bool parse_move(std::string_view s, UciMove &m);
+    std::string to_string(const UciMove &m);
+
+    // Arguments of a "position" command: start is "startpos" or the FEN
+    struct PositionCommand
+    {
+        std::string start;
+        std::vector<std::string> moves;
+    };
+
+    // args is the command line after "position"; false without a start
+    bool parse_position(const std::string &args, PositionCommand &cmd);
+
+    // The fields of a FEN; squares run a1 = 0 to h8 = 63
+    struct Fen
+    {
+        PieceType_t piece[64];
+        ColorType_t color[64];          // of the piece, where piece is not Piece::NONE
+        ColorType_t side = Color::WHITE;
+        uint16 castling[2] = {0, 0};    // per color, 1 king side and 2 queen side, as Zobrist::castle takes them
+        int ep_file = -1;               // -1 without an en passant square
+        int halfmove = 0;
+        int fullmove = 1;
+    };
+
+    // Checks the form of each field (eight ranks of eight files, one king a side)
+    // but not whether the position can arise. Castling, en passant and the move
+    // clocks may be left off, as in EPD. False for a malformed FEN.
+    bool parse_fen(const std::string &s, Fen &fen);
+
+    // Zobrist key of the pieces, side to move, castling rights and en passant file
+    uint64 key(const Fen &fen);
+
+    // GUIs resend the whole game with each move. When the board already holds
+    // prev and next only adds moves to it, returns the index in next.moves of
+    // the first move still to play; -1 when the board has to be set up again.
+    int resume_from(const PositionCommand &prev, const PositionCommand &next);
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "numa.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE (1 << 1)
+#endif
+#endif
+
+namespace
+{
+    // "0-3,8-11" -> {0, 1, 2, 3, 8, 9, 10, 11}
+    std::vector<int> parse_cpulist(const std::string &list)
+    {
+        std::vector<int> cpus;
+        std::istringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ','))
+        {
+            int lo, hi;
+            char dash;
+            std::istringstream r(range);
+            if (!(r >> lo))
+                continue;
+            hi = (r >> dash >> hi) ? hi : lo;
+            for (int c = lo; c <= hi; ++c)
+                cpus.push_back(c);
+        }
+        return cpus;
+    }
+
+    std::vector<Numa::Node> read_nodes()
+    {
+        std::vector<Numa::Node> nodes;
+#if defined(__linux__)
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        const bool have_mask = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+        auto usable = [&](int c) { return !have_mask || (c < CPU_SETSIZE && CPU_ISSET(c, &allowed)); };
+
+        for (int id = 0; id < 1024; ++id)
+        {
+            std::ifstream f("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+            std::string list;
+            if (!f || !std::getline(f, list))
+                continue;
+            Numa::Node n{id, {}};
+            for (int c : parse_cpulist(list))
+                if (usable(c))
+                    n.cpus.push_back(c);
+            if (!n.cpus.empty())
+                nodes.push_back(n);
+        }
+        if (nodes.empty())
+        {
+            Numa::Node n{0, {}};
+            for (int c = 0; c < CPU_SETSIZE; ++c)
+                if (have_mask ? CPU_ISSET(c, &allowed) : c < int(std::thread::hardware_concurrency()))
+                    n.cpus.push_back(c);
+            nodes.push_back(n);
+        }
+#else
+        Numa::Node n{0, {}};
+        for (int c = 0; c < int(std::max(1u, std::thread::hardware_concurrency())); ++c)
+            n.cpus.push_back(c);
+        nodes.push_back(n);
+#endif
+        return nodes;
+    }
+}
+
+const std::vector<Numa::Node> &Numa::nodes()
+{
+    static const std::vector<Node> n = read_nodes();
+    return n;
+}
+
+int Numa::node_of(unsigned int thread)
+{
+    return nodes()[thread % nodes().size()].id;
+}
+
+int Numa::cpu_of(unsigned int thread)
+{
+    const Node &n = nodes()[thread % nodes().size()];
+    return n.cpus[(thread / nodes().size()) % n.cpus.size()];
+}
+
+bool Numa::bind_thread(unsigned int thread)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu_of(thread), &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)thread;
+    return false;
+#endif
+}
+
+bool Numa::interleave(const Memory::Block &b)
+{
+#if defined(__linux__)
+    if (!b.ptr || nodes().size() < 2)
+        return false;
+
+    unsigned long mask[1024 / (8 * sizeof(unsigned long))] = {};
+    const size_t bits = 8 * sizeof(unsigned long);
+    for (const Node &n : nodes())
+        mask[size_t(n.id) / bits] |= 1UL << (size_t(n.id) % bits);
+
+    // mbind wants a page aligned range, heap blocks are only cache line aligned
+    const uintptr_t page = uintptr_t(sysconf(_SC_PAGESIZE));
+    const uintptr_t lo = (reinterpret_cast<uintptr_t>(b.ptr) + page - 1) / page * page;
+    const uintptr_t hi = (reinterpret_cast<uintptr_t>(b.ptr) + b.bytes) / page * page;
+    if (hi <= lo)
+        return false;
+    return syscall(SYS_mbind, lo, hi - lo, MPOL_INTERLEAVE, mask, 1024, MPOL_MF_MOVE) == 0;
+#else
+    (void)b;
+    return false;
+#endif
+}
+
+std::string Numa::describe()
+{
+    size_t cpus = 0;
+    for (const Node &n : nodes())
+        cpus += n.cpus.size();
+    std::ostringstream ss;
+    ss << nodes().size() << (nodes().size() == 1 ? " node, " : " nodes, ") << cpus << (cpus == 1 ? " cpu" : " cpus");
+    return ss.str();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#ifndef NUMA_H_
+#define NUMA_H_
+
+#include <string>
+#include <vector>
+
+#include "memory.h"
+
+namespace Numa {
+
+    struct Node
+    {
+        int id;
+        std::vector<int> cpus; // the ones this process may run on
+    };
+
+    // NUMA nodes with at least one usable CPU, read once from sysfs. Without
+    // NUMA information (or off Linux) this is one node holding every CPU.
+    const std::vector<Node> &nodes();
+
+    // Search thread i goes to node i % nodes, so consecutive threads spread over
+    // the sockets, and to the (i / nodes)-th CPU of that node.
+    int node_of(unsigned int thread);
+    int cpu_of(unsigned int thread);
+
+    // Pins the calling thread to cpu_of(thread). Memory it touches first after
+    // that (its search state) is then placed on its own node.
+    bool bind_thread(unsigned int thread);
+
+    // Spreads the pages of b round robin over all nodes (MPOL_INTERLEAVE),
+    // moving the ones already touched. No-op on a single node.
+    bool interleave(const Memory::Block &b);
+
+    // e.g. "2 nodes, 64 cpus"
+    std::string describe();
+}
+
+#endif
@@ -0,0 +1,18 @@
+#include "search.h"
+
+namespace
+{
+    // Helper i (from 1) skips iteration d when ((d + phase) / size) is odd: helpers
+    // 1-2 skip every other depth, 3-6 pairs of depths, and so on, with phases spread
+    // so each depth is covered by some helpers.
+    constexpr int SKIP_SIZE[20] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+    constexpr int SKIP_PHASE[20] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+}
+
+bool Search::skip_depth(unsigned int id, int depth)
+{
+    if (id == 0)
+        return false;
+    const int i = int((id - 1) % 20);
+    return ((depth + SKIP_PHASE[i]) / SKIP_SIZE[i]) % 2 != 0;
+}
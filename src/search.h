@@ -0,0 +1,357 @@
+#pragma once
+
+#ifndef SEARCH_H_
+#define SEARCH_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "hashtable.h"
+#include "numa.h"
+#include "threads.h"
+#include "timeman.h"
+#include "types.h"
+
+namespace Search {
+
+    // LAZY: threads share only the transposition table and spread over depths.
+    // ABDADA: all threads search the same depth; non-PV nodes are marked busy in
+    // the table and a thread defers a sibling another thread is already inside.
+    enum class SmpMode { LAZY, ABDADA };
+
+    // Nodes shallower than this are not marked, they are cheaper to search twice.
+    constexpr int ABDADA_MIN_DEPTH = 2;
+
+    // Per-thread search state, allocated once per SearchPool::init (by a thread bound
+    // to its node when binding is on) and reused by every search.
+    template <class Position>
+    struct ThreadData
+    {
+        unsigned int id;
+        Position pos;                                               // private copy of the root
+        std::atomic<uint64> nodes{0};
+        std::atomic<uint64> overlaps{0};                            // entered a node another thread was in
+        std::atomic<uint64> deferred{0};                            // moves postponed to the end of the loop
+        SmpMode mode = SmpMode::LAZY;
+        bool mark_nodes = false;                                    // ABDADA, or LAZY measuring overlap
+        int completed_depth = 0;
+        double search_ms = 0.0;                                     // wall time of the last search
+        Move best_move;
+        int best_score = 0;
+        std::array<std::array<std::array<int16, 64>, 64>, 2> history{}; // [color][from][to]
+        tiered_table tt;                                            // shared ttable (+ optional local tier)
+
+        ThreadData(unsigned int i, hash_table &table, size_t local_hash) : id(i), tt(table, local_hash) {}
+    };
+
+    struct Result
+    {
+        Move move;
+        int score = 0;
+        int depth = 0;
+        uint64 nodes = 0;
+        uint64 overlaps = 0;
+        uint64 deferred = 0;
+        unsigned int thread = 0; // whose move won the vote
+    };
+
+    // Marks a non-PV node busy for as long as the thread is inside it:
+    //     BusyMark<Position> busy(td, key, depth, pv_node);
+    template <class Position>
+    class BusyMark
+    {
+    private:
+        ThreadData<Position> &td_;
+        uint64 key_;
+        bool owned_ = false;
+
+    public:
+        BusyMark(ThreadData<Position> &td, uint64 key, int depth, bool pv_node) : td_(td), key_(key)
+        {
+            if (!td.mark_nodes || pv_node || depth < ABDADA_MIN_DEPTH)
+                return;
+            bool overlap;
+            owned_ = td.tt.mark_searching(key, overlap);
+            if (overlap)
+                td.overlaps.store(td.overlaps.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        ~BusyMark()
+        {
+            if (owned_)
+                td_.tt.clear_searching(key_);
+        }
+        BusyMark(const BusyMark &) = delete;
+        BusyMark &operator=(const BusyMark &) = delete;
+    };
+
+    // ABDADA deferral test for the move loop: true when a move other than the
+    // first leads to a position another thread is searching. The caller puts
+    // it aside and searches it after the other moves.
+    template <class Position>
+    bool defer_move(ThreadData<Position> &td, uint64 child_key, int move_index, int depth)
+    {
+        if (td.mode != SmpMode::ABDADA || move_index == 0 || depth - 1 < ABDADA_MIN_DEPTH || !td.tt.is_searching(child_key))
+            return false;
+        td.deferred.store(td.deferred.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Lazy SMP depth skew: helper threads skip some iterations, so at any time the
+    // threads spread over neighbouring depths and fill the table for each other.
+    bool skip_depth(unsigned int id, int depth);
+
+    // Picks the move with the most votes, each thread voting for its best move with
+    // weight (score - worst score + 14) * completed depth; the main thread wins ties.
+    template <class Position>
+    unsigned int vote(const std::vector<std::unique_ptr<ThreadData<Position>>> &threads);
+
+    // Every thread runs its own iterative deepening over the same root. In LAZY
+    // mode they share nothing but the transposition table; in ABDADA mode they
+    // also see each other's busy marks through it (BusyMark, defer_move).
+    template <class Position>
+    class SearchPool
+    {
+    private:
+        ThreadPool<WorkerThread> workers_;
+        TimerThread timer_;
+        std::vector<std::unique_ptr<ThreadData<Position>>> data_;
+        hash_table *table_ = nullptr;
+        std::atomic_bool stop_{false};
+        std::atomic_bool ponder_{false};
+        std::atomic<Time::Manager *> time_{nullptr};
+        std::atomic<std::chrono::steady_clock::rep> origin_{0}; // where the clock starts: go, or ponderhit
+        SmpMode mode_ = SmpMode::LAZY;
+        bool measure_overlap_ = false;
+        bool bind_ = false;
+        size_t local_hash_ = 0;
+
+        static double ms_since(std::chrono::steady_clock::time_point t)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+        }
+
+        std::chrono::steady_clock::time_point origin() const
+        {
+            return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(origin_.load()));
+        }
+
+    public:
+        SearchPool() { init(1); }
+        ~SearchPool()
+        {
+            if (table_ && table_->threads() == &workers_)
+                table_->set_threads(nullptr);
+            workers_.exit();
+        }
+
+        // Workers already running are kept, only the difference is started or retired.
+        // Each ThreadData is allocated (and first touched) by the thread that will
+        // search it, after binding, so with binding on it lands on that thread's node.
+        void init(unsigned int num_threads, hash_table &table = ttable, size_t local_hash = 0)
+        {
+            num_threads = std::max(num_threads, 1u);
+            if (table_ && table_ != &table && table_->threads() == &workers_)
+                table_->set_threads(nullptr);
+            table_ = &table;
+            table.set_threads(&workers_); // clear() runs on the search threads
+            local_hash_ = local_hash;
+            workers_.resize(num_threads);
+            data_.clear();
+            data_.resize(num_threads);
+
+            TaskGroup group;
+            for (unsigned int i = 0; i < num_threads; ++i)
+                workers_.enqueue(group, [this, i, &table, local_hash]
+                                 {
+                                     if (bind_)
+                                         Numa::bind_thread(i);
+                                     data_[i] = std::make_unique<ThreadData<Position>>(i, table, local_hash);
+                                 });
+            workers_.wait(group);
+        }
+
+        // Pin search thread i to Numa::cpu_of(i), spreading the threads over the
+        // nodes. Switching it off restarts the workers, new threads are unpinned.
+        void set_binding(bool on)
+        {
+            if (on == bind_)
+                return;
+            bind_ = on;
+            const unsigned int n = unsigned(data_.size());
+            if (!on)
+                workers_.resize(0);
+            init(n, *table_, local_hash_);
+        }
+        bool binding() const { return bind_; }
+
+        size_t num_workers() const { return data_.size(); }
+        ThreadData<Position> &operator[](size_t i) { return *data_[i]; }
+        const std::atomic_bool &stopped() const { return stop_; }
+
+        // Also ends pondering, the search then returns its best move at once
+        void stop()
+        {
+            stop_ = true;
+            ponder_ = false;
+            ponder_.notify_all();
+        }
+
+        // Set before starting a "go ponder" search: it then runs on the opponent's
+        // time, ignores its deadlines and does not return before ponderhit() or stop().
+        void set_ponder(bool on) { ponder_ = on; }
+        bool pondering() const { return ponder_; }
+
+        // The opponent played the expected move: the search carries on, now timed
+        // from this moment. If it has already thought for longer than a normal
+        // move would take, it stops right away.
+        void ponderhit()
+        {
+            const auto now = std::chrono::steady_clock::now();
+            const double pondered = ms_since(origin());
+            origin_ = now.time_since_epoch().count();
+            Time::Manager *time = time_;
+            if (time && time->limited())
+            {
+                timer_.arm(now + std::chrono::milliseconds(time->hard_ms()), stop_);
+                if (pondered >= time->soft_ms())
+                    stop_ = true;
+            }
+            ponder_ = false;
+            ponder_.notify_all();
+        }
+        void set_mode(SmpMode mode) { mode_ = mode; }
+        SmpMode mode() const { return mode_; }
+        // Mark nodes in LAZY mode too, only to count overlaps (costs an atomic per node)
+        void measure_overlap(bool on) { measure_overlap_ = on; }
+
+        uint64 nodes() const { return sum(&ThreadData<Position>::nodes); }
+
+        // Per-thread nodes and speed of the last search, to spot imbalanced threads:
+        //   thread  3  cpu 35  node 1  depth 18  4120345 nodes  1412 knps
+        void report_threads(std::ostream &os) const
+        {
+            for (auto &d : data_)
+            {
+                const uint64 n = d->nodes.load(std::memory_order_relaxed);
+                os << "thread " << std::setw(3) << d->id;
+                if (bind_)
+                    os << "  cpu " << std::setw(3) << Numa::cpu_of(d->id) << "  node " << Numa::node_of(d->id);
+                os << "  depth " << std::setw(2) << d->completed_depth << "  " << std::setw(10) << n << " nodes  "
+                   << std::setw(6) << uint64(d->search_ms > 0 ? double(n) / d->search_ms : 0.0) << " knps\n";
+            }
+        }
+
+        uint64 sum(std::atomic<uint64> ThreadData<Position>::*counter) const
+        {
+            uint64 n = 0;
+            for (auto &d : data_)
+                n += ((*d).*counter).load(std::memory_order_relaxed);
+            return n;
+        }
+
+        // iterate(ThreadData &, depth, const std::atomic_bool &stop) searches one
+        // iteration and returns {best move, score}. Blocks until the main thread
+        // has finished max_depth (or stop() was called, or time ran out) and all
+        // helpers returned. With a time manager the main thread stops after the
+        // iteration that passes its soft limit, the timer stops all at the hard one.
+        // While pondering neither applies and the main thread waits at max_depth.
+        template <class Iterate>
+        Result search(const Position &root, int max_depth, Iterate iterate, Time::Manager *time = nullptr)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            stop_ = false;
+            origin_ = start.time_since_epoch().count();
+            time_ = time;
+            if (time && time->limited() && !ponder_)
+                timer_.arm(start + std::chrono::milliseconds(time->hard_ms()), stop_);
+            table_->new_search();
+            for (auto &d : data_)
+            {
+                d->pos = root;
+                d->nodes = 0;
+                d->overlaps = 0;
+                d->deferred = 0;
+                d->mode = mode_;
+                d->mark_nodes = (mode_ == SmpMode::ABDADA || measure_overlap_);
+                d->completed_depth = 0;
+                d->best_move = Move();
+            }
+
+            TaskGroup group;
+            for (auto &d : data_)
+            {
+                ThreadData<Position> *td = d.get();
+                workers_.enqueue(group, [this, td, max_depth, &iterate, time, start]
+                                 {
+                                     if (bind_)
+                                         Numa::bind_thread(td->id); // whichever worker runs td goes to td's cpu
+                                     for (int depth = 1; depth <= max_depth && !stop_; ++depth)
+                                     {
+                                         if (mode_ == SmpMode::LAZY && skip_depth(td->id, depth))
+                                             continue;
+                                         auto [move, score] = iterate(*td, depth, stop_);
+                                         if (stop_ && td->completed_depth)
+                                             break; // interrupted: keep the last full iteration
+                                         td->best_move = move;
+                                         td->best_score = score;
+                                         td->completed_depth = depth;
+                                         if (td->id == 0 && time &&
+                                             time->stop_after_iteration(ms_since(origin()), move, score) && !ponder_)
+                                             break;
+                                     }
+                                     if (td->id == 0)
+                                     {
+                                         while (ponder_ && !stop_)
+                                             ponder_.wait(true); // no bestmove before ponderhit or stop
+                                         stop_ = true; // main thread done, helpers follow
+                                     }
+                                     td->search_ms = ms_since(start);
+                                 });
+            }
+            workers_.wait(group);
+            timer_.cancel();
+            time_ = nullptr;
+            ponder_ = false;
+
+            unsigned int winner = vote(data_);
+            const ThreadData<Position> &w = *data_[winner];
+            return Result{w.best_move, w.best_score, w.completed_depth, nodes(),
+                          sum(&ThreadData<Position>::overlaps), sum(&ThreadData<Position>::deferred), winner};
+        }
+    };
+
+    template <class Position>
+    unsigned int vote(const std::vector<std::unique_ptr<ThreadData<Position>>> &threads)
+    {
+        int min_score = threads[0]->best_score;
+        for (auto &t : threads)
+            if (t->completed_depth)
+                min_score = std::min(min_score, t->best_score);
+
+        auto key = [](const Move &m) { return (int(m.from) << 16) | (int(m.to) << 8) | (m.type & 0xFF); };
+        std::map<int, int64_t> votes;
+        for (auto &t : threads)
+            if (t->completed_depth)
+                votes[key(t->best_move)] += int64_t(t->best_score - min_score + 14) * t->completed_depth;
+
+        unsigned int best = 0;
+        for (auto &t : threads)
+        {
+            const ThreadData<Position> &b = *threads[best];
+            if (!t->completed_depth)
+                continue;
+            int64_t tv = votes[key(t->best_move)], bv = votes[key(b.best_move)];
+            if (tv > bv || (tv == bv && t->completed_depth > b.completed_depth))
+                best = t->id;
+        }
+        return best;
+    }
+}
+
+#endif
@@ -6,12 +6,21 @@
 #include <functional>
 #include <thread>
 #include <condition_variable>
+#include <future>
 #include <mutex>
 #include <vector>
 #include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <new>
 #include <tuple>
+#include <type_traits>
+#include <utility>
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
 
 // #include "material.h"
 // #include "pawns.h"
@@ -40,116 +49,717 @@ public:
     std::thread &thread() { return thread_; }
 };
 
+// Sets a stop flag once a deadline on steady_clock passes, so the search
+// threads only load an atomic in their hot loop and never read the clock.
+// One thread, started with the first arm() and reused for every search.
 class TimerThread : public WorkerThread {
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::chrono::steady_clock::time_point deadline_;
+    std::atomic_bool *target_ = nullptr;
+    std::atomic_bool fired_{false};
+    bool quit_ = false;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!quit_) {
+            if (!target_) {
+                cv_.wait(lock);
+            } else if (std::chrono::steady_clock::now() >= deadline_) {
+                target_->store(true);
+                target_ = nullptr;
+                fired_ = true;
+            } else {
+                cv_.wait_until(lock, deadline_); // re-armed, cancelled or due
+            }
+        }
+    }
+
 public:
     TimerThread() {}
-    TimerThread(std::function<void()> func) : WorkerThread(func) {}
+
+    ~TimerThread() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            quit_ = true;
+        }
+        cv_.notify_one();
+        if (thread().joinable())
+            thread().join(); // before the members run() uses go away
+    }
+
+    // Replaces any pending deadline
+    void arm(std::chrono::steady_clock::time_point deadline, std::atomic_bool &stop) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            deadline_ = deadline;
+            target_ = &stop;
+            fired_ = false;
+        }
+        if (!thread().joinable())
+            thread() = std::thread([this] { run(); });
+        cv_.notify_one();
+    }
+
+    void cancel() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            target_ = nullptr;
+        }
+        cv_.notify_one();
+    }
+
+    // The last armed deadline passed and set its flag
+    bool fired() const { return fired_; }
 };
 
-template <class T>
+// Completion handle for a set of tasks. ThreadPool::enqueue(group, ...) adds a
+// task to it and wait() blocks exactly until all of them have run (or were
+// dropped by clear_tasks). Must outlive its tasks; may be reused once finished.
+class TaskGroup {
+public:
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup &) = delete;
+    TaskGroup &operator=(const TaskGroup &) = delete;
+
+    ~TaskGroup() { assert(pending_ == 0); }
+
+    unsigned int pending() const { return pending_; }
+    bool finished() const { return pending_ == 0; }
+
+    // Not from a worker of a SharedQueue pool whose other workers may all be
+    // waiting too: nobody would be left to run the tasks.
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return pending_ == 0; });
+    }
+
+    void add() { ++pending_; }
+
+    // Only the last task takes the lock, so a waiter cannot return (and the
+    // group go out of scope) between the final decrement and the notify.
+    void done() {
+        unsigned int p = pending_.load(std::memory_order_relaxed);
+        while (p > 1 && !pending_.compare_exchange_weak(p, p - 1))
+            ;
+        if (p > 1)
+            return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0)
+            cv_.notify_all();
+    }
+
+private:
+    std::atomic_uint pending_{0};
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+// ThreadPool scheduler backends: one mutex/condvar protected queue shared by all
+// workers (the default), or per-worker work-stealing deques.
+struct SharedQueue {};
+struct WorkStealing {};
+
+template <class T, class Scheduler = SharedQueue>
 class ThreadPool {
 private:
+    struct QueuedTask {
+        std::function<void()> fn;
+        TaskGroup *group;
+    };
+
     std::vector<std::unique_ptr<T>> workers_;
-    std::queue<std::function<void()>> task_queue_;
+    std::queue<QueuedTask> task_queue_;
     std::mutex mutex_;
     std::condition_variable cv_task_;
-    std::condition_variable cv_finished_;
-    std::atomic_uint busy_;
+    TaskGroup all_; // every task, for wait_finished
     std::atomic_uint processed_;
     std::atomic_bool stop_;
-    unsigned int num_threads_;
+    unsigned int num_threads_; // workers with a higher index retire
+
+    void finish(TaskGroup *group) {
+        ++processed_;
+        if (group)
+            group->done();
+        all_.done();
+    }
 
-    void thread_func() {
+    void thread_func(unsigned int index) {
         while (true) {
             std::unique_lock<std::mutex> lock(mutex_);
-            cv_task_.wait(lock, [this]() { return stop_ || !task_queue_.empty(); });
+            cv_task_.wait(lock, [this, index]() { return stop_ || !task_queue_.empty() || index >= num_threads_; });
 
             if (!task_queue_.empty()) {
-                ++busy_;
-                auto fn = std::move(task_queue_.front());
+                QueuedTask task = std::move(task_queue_.front());
                 task_queue_.pop();
                 lock.unlock();
-                fn();
-                ++processed_;
-                lock.lock();
-                --busy_;
-                cv_finished_.notify_one();
-            } else if (stop_) {
+                task.fn();
+                finish(task.group);
+            } else {
                 break;
             }
         }
     }
 
 public:
-    ThreadPool() {}
+    ThreadPool() : processed_(0), stop_(true), num_threads_(0) {}
 
-    explicit ThreadPool(const unsigned int num_threads) 
-        : busy_(0), processed_(0), stop_(false), num_threads_(num_threads) {
-        for (unsigned int i = 0; i < num_threads_; ++i) {
-            workers_.emplace_back(std::make_unique<T>([this] { thread_func(); }));
-        }
+    explicit ThreadPool(const unsigned int num_threads)
+        : processed_(0), stop_(true), num_threads_(0) {
+        resize(num_threads);
     }
 
-    ~ThreadPool() {
-        if (!stop_) {
-            exit();
+    ~ThreadPool() { exit(); }
+
+    // Waits for the running tasks, then starts or retires workers to reach
+    // num_threads. Workers that stay are not restarted.
+    void resize(const unsigned int num_threads) {
+        if (!workers_.empty())
+            all_.wait();
+        processed_ = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stop_ = false;
+            num_threads_ = num_threads;
+        }
+        if (workers_.size() > num_threads) {
+            cv_task_.notify_all();
+            workers_.resize(num_threads); // joins the retired workers
+        }
+        for (unsigned int i = unsigned(workers_.size()); i < num_threads; ++i) {
+            workers_.emplace_back(std::make_unique<T>([this, i] { thread_func(i); }));
         }
     }
 
-    void init(const int num_threads) {
-        exit();
+    void init(const int num_threads) { resize(unsigned(num_threads)); }
+
+    template<class TT, typename... Args>
+    void enqueue(TT&& f, Args&&... args) {
+        push(nullptr, std::forward<TT>(f), std::forward<Args>(args)...);
+    }
+
+    template<class TT, typename... Args>
+    TaskGroup &enqueue(TaskGroup &group, TT&& f, Args&&... args) {
+        push(&group, std::forward<TT>(f), std::forward<Args>(args)...);
+        return group;
+    }
+
+    // One-off task with a result (allocates its shared state)
+    template<class TT, typename... Args>
+    auto submit(TT&& f, Args&&... args) {
+        using R = std::invoke_result_t<std::decay_t<TT>, std::decay_t<Args>...>;
+        auto task = std::make_shared<std::packaged_task<R()>>(
+            [func = std::forward<TT>(f), args_tuple = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                return std::apply(func, args_tuple);
+            });
+        std::future<R> result = task->get_future();
+        enqueue([task] { (*task)(); });
+        return result;
+    }
+
+    void wait(TaskGroup &group) { group.wait(); }
+
+    void wait_finished() { all_.wait(); }
+
+    void exit() {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_task_.notify_all();
+        if (workers_.empty())
+            clear_tasks();
+        all_.wait();
         workers_.clear();
-        busy_ = 0;
-        processed_ = 0;
-        stop_ = false;
-        num_threads_ = num_threads;
+    }
+
+    size_t num_workers() const { return workers_.size(); }
 
-        for (unsigned int i = 0; i < num_threads_; ++i) {
-            workers_.emplace_back(std::make_unique<T>([this] { thread_func(); }));
+    unsigned int size() const { return num_threads_; }
+
+    unsigned int get_processed() const { return processed_; }
+
+    // Drops the tasks not started yet, their groups complete without them
+    void clear_tasks() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!task_queue_.empty()) {
+            TaskGroup *group = task_queue_.front().group;
+            task_queue_.pop();
+            if (group)
+                group->done();
+            all_.done();
         }
     }
 
+private:
     template<class TT, typename... Args>
-    void enqueue(TT&& f, Args&&... args) {
+    void push(TaskGroup *group, TT&& f, Args&&... args) {
+        if (group)
+            group->add();
+        all_.add();
         std::unique_lock<std::mutex> lock(mutex_);
-        task_queue_.emplace([func = std::forward<TT>(f), args_tuple = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+        task_queue_.push({[func = std::forward<TT>(f), args_tuple = std::make_tuple(std::forward<Args>(args)...)]() mutable {
             std::apply(func, args_tuple);
-        });
+        }, group});
         cv_task_.notify_one();
     }
+};
 
-    void wait_finished() {
-        std::unique_lock<std::mutex> lock(mutex_);
-        cv_finished_.wait_for(lock, std::chrono::seconds(5), [this]() {
-            return task_queue_.empty() && (busy_ == 0);
-        });
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(_M_X64)
+    _mm_pause();
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Type-erased void() callable stored in place. Callables of up to INLINE_BYTES
+// (the usual lambda capturing a few pointers or ints) never allocate; larger
+// ones are moved to the heap.
+class Task {
+public:
+    static constexpr size_t INLINE_BYTES = 40; // with ops_, 48 bytes: a deque slot fits a cache line
+
+    Task() = default;
+
+    template <class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+    explicit Task(F &&f) {
+        using Fn = std::decay_t<F>;
+        if constexpr (sizeof(Fn) <= INLINE_BYTES && alignof(Fn) <= alignof(std::max_align_t) &&
+                      std::is_nothrow_move_constructible_v<Fn>) {
+            ::new (static_cast<void *>(buf_)) Fn(std::forward<F>(f));
+            ops_ = &inline_ops<Fn>;
+        } else {
+            ::new (static_cast<void *>(buf_)) Fn *(new Fn(std::forward<F>(f)));
+            ops_ = &heap_ops<Fn>;
+        }
     }
 
-    void exit() {
-        {
+    Task(Task &&o) noexcept { o.move_to(*this); }
+
+    Task &operator=(Task &&o) noexcept {
+        if (this != &o) {
+            reset();
+            o.move_to(*this);
+        }
+        return *this;
+    }
+
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task() { reset(); }
+
+    void operator()() { ops_(Op::INVOKE, this, nullptr); }
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    void reset() {
+        if (ops_) {
+            ops_(Op::DESTROY, this, nullptr);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    enum class Op { INVOKE, MOVE, DESTROY };
+
+    alignas(std::max_align_t) unsigned char buf_[INLINE_BYTES];
+    void (*ops_)(Op, Task *, Task *) = nullptr;
+
+    void move_to(Task &dst) {
+        if (ops_) {
+            ops_(Op::MOVE, this, &dst);
+            dst.ops_ = ops_;
+            ops_ = nullptr;
+        }
+    }
+
+    template <class Fn>
+    static void inline_ops(Op op, Task *self, Task *dst) {
+        Fn *f = std::launder(reinterpret_cast<Fn *>(self->buf_));
+        switch (op) {
+        case Op::INVOKE: (*f)(); break;
+        case Op::MOVE: ::new (static_cast<void *>(dst->buf_)) Fn(std::move(*f)); f->~Fn(); break;
+        case Op::DESTROY: f->~Fn(); break;
+        }
+    }
+
+    template <class Fn>
+    static void heap_ops(Op op, Task *self, Task *dst) {
+        Fn **f = std::launder(reinterpret_cast<Fn **>(self->buf_));
+        switch (op) {
+        case Op::INVOKE: (**f)(); break;
+        case Op::MOVE: ::new (static_cast<void *>(dst->buf_)) Fn *(*f); break;
+        case Op::DESTROY: delete *f; break;
+        }
+    }
+};
+
+// Chase-Lev deque of fixed capacity. The owning worker pushes and pops at the
+// bottom (LIFO, cache warm), any thread steals from the top (FIFO, the oldest
+// and usually largest task). Tasks live in the slots; a slot is claimed through
+// top/bottom first and its task moved out afterwards, so each slot carries a
+// flag the owner waits on before reusing it.
+template <class Item>
+class WorkDeque {
+public:
+    static constexpr int64_t CAPACITY = 1024;
+
+    WorkDeque() : slots_(new Slot[CAPACITY]) {}
+
+    // Owner only. False (task left untouched) when full.
+    bool push(Item &&item) {
+        const int64_t b = bottom_.load(std::memory_order_relaxed);
+        const int64_t t = top_.load(std::memory_order_acquire);
+        if (b - t >= CAPACITY)
+            return false;
+        Slot &s = slots_[b & (CAPACITY - 1)];
+        while (s.full.load(std::memory_order_acquire))
+            cpu_relax(); // a thief is still moving the previous item out
+        s.item = std::move(item);
+        s.full.store(true, std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Owner only
+    bool pop(Item &out) {
+        const int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        if (t == b) {
+            // last task, race the thieves for it
+            const bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            if (!won)
+                return false;
+        }
+        take(slots_[b & (CAPACITY - 1)], out);
+        return true;
+    }
+
+    // Any thread
+    bool steal(Item &out) {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b)
+            return false;
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return false;
+        take(slots_[t & (CAPACITY - 1)], out);
+        return true;
+    }
+
+private:
+    struct alignas(64) Slot {
+        Item item;
+        std::atomic_bool full{false};
+    };
+
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    std::unique_ptr<Slot[]> slots_;
+
+    static void take(Slot &s, Item &out) {
+        out = std::move(s.item);
+        s.full.store(false, std::memory_order_release);
+    }
+};
+
+// Bounded lock-free MPMC queue (per-cell sequence numbers) taking the tasks
+// submitted from outside the pool.
+template <class Item>
+class TaskQueue {
+public:
+    static constexpr size_t CAPACITY = 4096;
+
+    TaskQueue() : cells_(new Cell[CAPACITY]) {
+        for (size_t i = 0; i < CAPACITY; ++i)
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // False (task left untouched) when full
+    bool push(Item &&item) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &c = cells_[pos & (CAPACITY - 1)];
+            const size_t seq = c.seq.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    c.item = std::move(item);
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(Item &out) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &c = cells_[pos & (CAPACITY - 1)];
+            const size_t seq = c.seq.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(c.item);
+                    c.seq.store(pos + CAPACITY, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    struct alignas(64) Cell {
+        Item item;
+        std::atomic<size_t> seq{0};
+    };
+
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+    std::unique_ptr<Cell[]> cells_;
+};
+
+// Work-stealing backend, same interface as the shared queue. Tasks enqueued by a
+// worker of the pool go to its own deque, tasks from any other thread to a
+// lock-free injection queue. Idle workers pop their deque, then the injection
+// queue, then steal round robin from the others; after SPIN_ROUNDS empty
+// rounds they park on a condition variable. No lock is taken per task.
+template <class T>
+class ThreadPool<T, WorkStealing> {
+private:
+    static constexpr int SPIN_ROUNDS = 64;
+    static constexpr unsigned int MAX_WORKERS = 1024;
+
+    struct Job {
+        Task task;
+        TaskGroup *group = nullptr;
+    };
+
+    std::vector<std::unique_ptr<T>> workers_;
+    // Fixed array so thieves can index it while the pool grows; a deque is
+    // created with its first worker and kept for reuse after a shrink.
+    std::unique_ptr<std::unique_ptr<WorkDeque<Job>>[]> deques_;
+    TaskQueue<Job> injector_;
+    std::mutex mutex_; // parking only
+    std::condition_variable cv_task_;
+    TaskGroup all_; // every task, for wait_finished
+    std::atomic_int queued_;        // submitted, not yet taken by a worker
+    std::atomic_uint sleeping_;
+    std::atomic_uint processed_;
+    std::atomic_uint active_;       // workers with a higher index retire
+    std::atomic_bool stop_;
+
+    static inline thread_local ThreadPool *current_pool_ = nullptr;
+    static inline thread_local unsigned int current_index_ = 0;
+
+    bool find_task(unsigned int index, Job &job) {
+        const unsigned int n = active_.load(std::memory_order_acquire);
+        bool found = (index < n && deques_[index]->pop(job)) || injector_.pop(job);
+        for (unsigned int i = 1; !found && i < n; ++i)
+            found = deques_[(index + i) % n]->steal(job);
+        if (found)
+            --queued_;
+        return found;
+    }
+
+    void run(Job &job) {
+        job.task();
+        job.task.reset();
+        finish(job.group);
+    }
+
+    void finish(TaskGroup *group) {
+        ++processed_;
+        if (group)
+            group->done();
+        all_.done();
+    }
+
+    void thread_func(unsigned int index) {
+        current_pool_ = this;
+        current_index_ = index;
+        Job job;
+        while (true) {
+            bool found = false;
+            for (int i = 0; i < SPIN_ROUNDS && !found; ++i) {
+                found = find_task(index, job);
+                if (!found)
+                    (i < SPIN_ROUNDS / 2 ? cpu_relax() : std::this_thread::yield());
+            }
+            if (found) {
+                run(job);
+                continue;
+            }
+            if ((stop_ && queued_ <= 0) || index >= active_)
+                break;
+
             std::unique_lock<std::mutex> lock(mutex_);
-            stop_ = true;
+            ++sleeping_;
+            cv_task_.wait(lock, [this, index]() { return stop_ || queued_ > 0 || index >= active_; });
+            --sleeping_;
         }
+        current_pool_ = nullptr;
+    }
+
+    void wake_all() {
+        std::lock_guard<std::mutex> lock(mutex_);
         cv_task_.notify_all();
-        wait_finished();
+    }
 
-        for (auto& t : workers_) {
-            if (t->thread().joinable()) {
-                t->thread().join();
-            }
+public:
+    ThreadPool()
+        : deques_(new std::unique_ptr<WorkDeque<Job>>[MAX_WORKERS]),
+          queued_(0), sleeping_(0), processed_(0), active_(0), stop_(true) {}
+
+    explicit ThreadPool(const unsigned int num_threads) : ThreadPool() {
+        resize(num_threads);
+    }
+
+    ~ThreadPool() { exit(); }
+
+    // Waits for the running tasks, then starts or retires workers to reach
+    // num_threads (at most MAX_WORKERS). Workers that stay are not restarted.
+    void resize(unsigned int num_threads) {
+        num_threads = std::min(num_threads, MAX_WORKERS);
+        if (!workers_.empty())
+            all_.wait();
+        processed_ = 0;
+        stop_ = false;
+        for (unsigned int i = active_; i < num_threads; ++i)
+            if (!deques_[i])
+                deques_[i] = std::make_unique<WorkDeque<Job>>();
+        active_ = num_threads;
+        if (workers_.size() > num_threads) {
+            wake_all();
+            workers_.resize(num_threads); // joins the retired workers
+        }
+        for (unsigned int i = unsigned(workers_.size()); i < num_threads; ++i) {
+            workers_.emplace_back(std::make_unique<T>([this, i] { thread_func(i); }));
         }
+    }
+
+    void init(const int num_threads) { resize(unsigned(num_threads)); }
+
+    template<class TT, typename... Args>
+    void enqueue(TT&& f, Args&&... args) {
+        push(nullptr, std::forward<TT>(f), std::forward<Args>(args)...);
+    }
+
+    template<class TT, typename... Args>
+    TaskGroup &enqueue(TaskGroup &group, TT&& f, Args&&... args) {
+        push(&group, std::forward<TT>(f), std::forward<Args>(args)...);
+        return group;
+    }
+
+    // One-off task with a result (allocates its shared state)
+    template<class TT, typename... Args>
+    auto submit(TT&& f, Args&&... args) {
+        using R = std::invoke_result_t<std::decay_t<TT>, std::decay_t<Args>...>;
+        std::packaged_task<R()> task(
+            [func = std::forward<TT>(f), args_tuple = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                return std::apply(func, args_tuple);
+            });
+        std::future<R> result = task.get_future();
+        enqueue(std::move(task));
+        return result;
+    }
+
+    // From a worker of this pool, runs other tasks while waiting (nested
+    // splitting: a parent waits on its children without blocking a thread).
+    void wait(TaskGroup &group) {
+        if (current_pool_ != this) {
+            group.wait();
+            return;
+        }
+        Job job;
+        while (!group.finished()) {
+            if (find_task(current_index_, job))
+                run(job);
+            else
+                std::this_thread::yield();
+        }
+        group.wait(); // pairs with the last done()
+    }
+
+    void wait_finished() { all_.wait(); }
+
+    void exit() {
+        stop_ = true;
+        wake_all();
+        if (workers_.empty())
+            clear_tasks();
+        all_.wait();
         workers_.clear();
+        active_ = 0;
     }
 
     size_t num_workers() const { return workers_.size(); }
 
-    unsigned int size() const { return num_threads_; }
+    unsigned int size() const { return active_; }
 
     unsigned int get_processed() const { return processed_; }
 
+    // Drops the tasks not started yet, their groups complete without them
     void clear_tasks() {
-        while (!task_queue_.empty()) {
-            task_queue_.pop();
+        Job job;
+        unsigned int dropped = 0;
+        while (injector_.pop(job) || steal_any(job)) {
+            ++dropped;
+            if (job.group)
+                job.group->done();
+            all_.done();
+        }
+        queued_ -= int(dropped);
+    }
+
+private:
+    bool steal_any(Job &job) {
+        for (unsigned int i = 0; i < MAX_WORKERS && deques_[i]; ++i)
+            if (deques_[i]->steal(job))
+                return true;
+        return false;
+    }
+
+    template<class TT, typename... Args>
+    void push(TaskGroup *group, TT&& f, Args&&... args) {
+        Job job{Task([func = std::forward<TT>(f), args_tuple = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+            std::apply(func, args_tuple);
+        }), group};
+        if (group)
+            group->add();
+        all_.add();
+        if (current_pool_ == this) {
+            if (!deques_[current_index_]->push(std::move(job)) && !injector_.push(std::move(job))) {
+                run(job); // both full, waiting here could wait on ourselves
+                return;
+            }
+        } else {
+            while (!injector_.push(std::move(job)))
+                std::this_thread::yield();
+        }
+        ++queued_;
+        if (sleeping_ > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cv_task_.notify_one();
         }
     }
 };
@@ -0,0 +1,67 @@
+#include <algorithm>
+
+#include "timeman.h"
+
+namespace
+{
+    // No new iteration after this share of the scaled soft limit, it would mostly
+    // overrun it. Set so that on the SimulatedClocks replay a move takes about
+    // the soft limit on average.
+    constexpr double START_SHARE = 0.8;
+
+    // Longest single move, as a multiple of the soft limit
+    constexpr double MAX_STRETCH = 5.0;
+}
+
+void Time::Manager::init(const limits &lims, ColorType_t us, int ply, int overhead)
+{
+    *this = Manager();
+
+    if (lims.movetime)
+    {
+        soft_ = hard_ = std::max(1, int(lims.movetime) - overhead);
+        fixed_ = true;
+        return;
+    }
+
+    const int time = int(us == Color::WHITE ? lims.wtime : lims.btime);
+    const int inc = int(us == Color::WHITE ? lims.winc : lims.binc);
+    if (lims.infinite || time <= 0)
+        return;
+
+    // Time for the moves up to the horizon, less the overhead each of them costs
+    const int mtg = lims.movestogo ? std::min(int(lims.movestogo), 50) : horizon(ply);
+    const double left = std::max(1.0, double(time) + double(inc) * (mtg - 1) - double(overhead) * (mtg + 2));
+    const double usable = std::max(1.0, double(time - overhead));
+
+    // Never more than most of what is on the clock; with one move to the control
+    // the rest of the clock is not needed afterwards.
+    const double max_hard = usable * (mtg == 1 ? 0.9 : 0.75);
+    const double soft = std::min(left / mtg, max_hard);
+    soft_ = std::max(1, int(soft));
+    hard_ = std::max(soft_, int(std::min(soft * MAX_STRETCH, max_hard)));
+}
+
+bool Time::Manager::stop_after_iteration(double elapsed_ms, const Move &best, int score)
+{
+    if (!limited())
+        return false;
+    if (fixed_)
+        return elapsed_ms >= soft_;
+
+    stable_ = (iterations_ && best == prev_best_) ? stable_ + 1 : 0;
+
+    // Unsettled best move: up to 1.4x, settled for a few iterations: down to 0.65x
+    double scale = (stable_ == 0 && iterations_ ? 1.4 : std::max(0.65, 1.15 - 0.1 * stable_));
+    // Falling score: up to 1.6x while the search looks for a way out
+    if (iterations_ && score < prev_score_)
+        scale *= 1.0 + std::min(prev_score_ - score, 120) / 200.0;
+
+    scale_ = scale;
+    prev_best_ = best;
+    prev_score_ = score;
+    ++iterations_;
+
+    const double limit = std::min(soft_ * scale_, double(hard_));
+    return elapsed_ms >= limit * START_SHARE;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef TIMEMAN_H_
+#define TIMEMAN_H_
+
+#include "types.h"
+#include "uci.h"
+
+namespace Time {
+
+    // Milliseconds kept back per move for GUI and process latency
+    constexpr int MOVE_OVERHEAD = 30;
+
+    // Moves the remaining clock is spread over in sudden death, shrinking as the
+    // game goes on (ply counts half moves from the start of the game).
+    constexpr int horizon(int ply) { return ply / 4 < 25 ? 50 - ply / 4 : 25; }
+
+    // Turns the UCI limits into two deadlines, in ms from the start of the search:
+    // soft, where the main thread stops starting new iterations (scaled by how
+    // settled the search looks), and hard, where a TimerThread stops everything.
+    class Manager
+    {
+    public:
+        void init(const limits &lims, ColorType_t us, int ply, int overhead = MOVE_OVERHEAD);
+
+        bool limited() const { return hard_ > 0; } // false for depth, nodes, mate and infinite
+        int soft_ms() const { return soft_; }
+        int hard_ms() const { return hard_; }
+        double scale() const { return scale_; }
+
+        // After each iteration the main thread completes. Updates the scale from the
+        // best move's stability and the score trend; true when the next iteration
+        // should not be started.
+        bool stop_after_iteration(double elapsed_ms, const Move &best, int score);
+
+    private:
+        int soft_ = 0;
+        int hard_ = 0;
+        bool fixed_ = false; // movetime: no scaling
+        double scale_ = 1.0;
+        int stable_ = 0;     // iterations the best move has not changed
+        int iterations_ = 0;
+        int prev_score_ = 0;
+        Move prev_best_;
+    };
+}
+
+#endif
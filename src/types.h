@@ -1,6 +1,7 @@
 #ifndef TYPES_H_
 #define TYPES_H_
 
+#include <array>
 #include <vector>
 #include <map>
 #include <string>
@@ -1,26 +1,57 @@
 
 #include "uci.h"
+#include "bench.h"
 #include "move.h"
 #include "search.h"
 #include "threads.h"
 #include "hashtable.h"
+#include "input.h"
+#include "notation.h"
+#include "magics.h"
+#include "numa.h"
 #include "threads.h"
 
 position uci_pos;
+Notation::PositionCommand uci_loaded; // what uci_pos was set up from, start empty when changed otherwise
 Move dbgmove;
 Threadpool<Workerthread> worker(1);
 signals UCI_SIGNALS;
 
 void uci::loop() {
 	uci_pos.params = eval::Parameters;
+	Magics::set_huge_pages(true); // HugePages defaults to on, the hash table allocates with it already
 
 	int numThreads = std::max(opts->value<int>("threads"), 1);
 	SearchThreads.init(numThreads);
 
+	// stop and ponderhit act on the search directly from the input thread,
+	// isready is answered there too unless earlier commands are still pending
+	Input::Reader reader(std::cin, [&](const std::string& line) {
+		std::string cmd = Input::command(line);
+		if (cmd == "stop") {
+			UCI_SIGNALS.stop = true;
+			SearchThreads.stop();
+			return true;
+		}
+		if (cmd == "ponderhit") {
+			UCI_SIGNALS.ponder_hit = true;
+			SearchThreads.ponderhit();
+			return true;
+		}
+		if (cmd == "isready" && reader.idle()) {
+			std::cout << "readyok" << std::endl;
+			return true;
+		}
+		if (cmd == "quit" || cmd == "exit")
+			SearchThreads.stop();
+		return false;
+	});
+
 	std::string input = "";
-	while (std::getline(std::cin, input)) {
+	while (reader.next(input)) {
 		if (!parse_command(input)) break;
 	}
+	worker.wait_finished();
 }
 
 
@@ -32,32 +63,54 @@ bool uci::parse_command(const std::string& input) {
 	while (instream >> std::skipws >> cmd) {
 		std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::tolower);
 
-		if (cmd == "position" && instream >> cmd) {
-
-			std::string tmp;
-			if (cmd == "startpos") {
-				getline(instream, tmp);
-				std::istringstream fen(START_FEN);
-				uci_pos.setup(fen);
-				load_position(tmp);
-			}
-			else {
-				std::string sfen = "";
-				while ((instream >> cmd) && cmd != "moves") sfen += cmd + " ";
-				getline(instream, tmp);
-				tmp = "moves " + tmp;
-				std::istringstream fen(sfen);
-				uci_pos.setup(fen);
-				load_position(tmp);
-			}
+		if (cmd == "position") {
+			std::string args;
+			getline(instream, args);
+			Notation::PositionCommand next;
+			if (Notation::parse_position(args, next))
+				load_position(next);
+			break;
 		}
 		else if (cmd == "setoption" && instream >> cmd && instream >> cmd)
 		{
 			if (cmd == "hash" && instream >> cmd && instream >> cmd)
 			{
 				auto sz = atoi(cmd.c_str());
-				opts->set("hashsize", sz);
-				ttable.resize(sz);
+				if (ttable.resize(sz)) {
+					opts->set("hashsize", sz);
+					std::cout << "info string hash " << ttable.page_info() << std::endl;
+				}
+				else
+					std::cout << "info string could not allocate " << sz << " MB of hash, keeping " << ttable.page_info() << std::endl;
+				break;
+			}
+			if (cmd == "hashsegment" && instream >> cmd && instream >> cmd)
+			{
+				std::string name = (cmd == "<empty>" ? "" : cmd);
+				opts->set("hashsegment", name);
+				if (ttable.set_shared(name))
+					std::cout << "info string hash " << (name.empty() ? "private, " : "shared as " + name + ", ") << ttable.page_info() << std::endl;
+				else
+					std::cout << "info string could not share hash as " << name << ", using a private table" << std::endl;
+				break;
+			}
+			if (cmd == "localhash" && instream >> cmd && instream >> cmd)
+			{
+				opts->set("localhash", atoi(cmd.c_str())); // KB per search thread, picked up by the next search
+				break;
+			}
+			if (cmd == "localhashdepth" && instream >> cmd && instream >> cmd)
+			{
+				opts->set("localhashdepth", atoi(cmd.c_str()));
+				break;
+			}
+			if (cmd == "hugepages" && instream >> cmd && instream >> cmd)
+			{
+				bool enabled = (cmd == "true");
+				opts->set("hugepages", enabled);
+				ttable.set_huge_pages(enabled);
+				Magics::set_huge_pages(enabled);
+				std::cout << "info string hash " << ttable.page_info() << ", slider tables " << Magics::page_info() << std::endl;
 				break;
 			}
 			if (cmd == "clear" && instream >> cmd)
@@ -65,6 +118,14 @@ bool uci::parse_command(const std::string& input) {
 				if (cmd == "hash")
 					ttable.clear();
 			}
+			if (cmd == "threadbinding" && instream >> cmd && instream >> cmd)
+			{
+				bool enabled = (cmd == "true");
+				opts->set("threadbinding", enabled);
+				SearchThreads.set_binding(enabled);
+				std::cout << "info string search threads " << (enabled ? "bound to cpus, " : "unbound, ") << Numa::describe() << std::endl;
+				break;
+			}
 			if (cmd == "threads" && instream >> cmd && instream >> cmd)
 			{
 				opts->set("threads", atoi(cmd.c_str()));
@@ -88,6 +149,7 @@ bool uci::parse_command(const std::string& input) {
 		}
 		else if (cmd == "undo") {
 			uci_pos.undo_move(dbgmove);
+			uci_loaded = {};
 		}
 		else if (cmd == "fdepth" && instream >> cmd) {
 			uci_pos.params.fixed_depth = atoi(cmd.c_str());
@@ -152,9 +214,48 @@ bool uci::parse_command(const std::string& input) {
 			if (isok) {
 				std::cout << "doing mv " << std::endl;
 				uci_pos.do_move(dbgmove);
+				uci_loaded = {};
 			}
 			else std::cout << cmd << " is not a legal move" << std::endl;
 		}
+		else if (cmd == "bench") {
+			// bench [depth] [threads] [hash]: the fixed suite through the real search
+			std::vector<std::string> args;
+			while (instream >> cmd) args.push_back(cmd);
+			Bench::Options bo = Bench::parse(args);
+			worker.wait_finished();
+			SearchThreads.init(bo.threads);
+			ttable.resize(bo.hash_mb);
+
+			Bench::Report report = Bench::run([&](const std::string& fen) {
+				limits lims;
+				memset(&lims, 0, sizeof(limits));
+				lims.depth = bo.depth;
+				std::istringstream ss(fen);
+				uci_pos.setup(ss);
+				ttable.clear();
+				Search::start(uci_pos, lims, true);
+				return SearchThreads.nodes();
+			}, std::cerr);
+			report.print(std::cerr);
+			uci_loaded = {};
+
+			int numThreads = std::max(opts->value<int>("threads"), 1);
+			SearchThreads.init(numThreads);
+			ttable.resize(opts->value<int>("hashsize"));
+		}
+		else if (cmd == "savehash" && instream >> cmd) {
+			std::cout << "info string " << (ttable.save_to(cmd) ? "saved hash to " : "could not save hash to ") << cmd << std::endl;
+		}
+		else if (cmd == "loadhash" && instream >> cmd) {
+			if (ttable.load_from(cmd))
+				std::cout << "info string loaded hash from " << cmd << ", " << ttable.page_info() << std::endl;
+			else
+				std::cout << "info string could not load hash from " << cmd << " (missing, truncated or incompatible)" << std::endl;
+		}
+		else if (cmd == "hashstats") {
+			ttable.dump_stats(std::cout);
+		}
 		else if (cmd == "debug") {
 			uci_pos.debug_search = !uci_pos.debug_search;
 			std::cout << "debugging set to: " << uci_pos.debug_search << std::endl;
@@ -162,10 +263,10 @@ bool uci::parse_command(const std::string& input) {
 
 		// game specific uci commands (refactor?)
 		else if (cmd == "isready") {
-			ttable.clear();
 			std::cout << "readyok" << std::endl;
 		}
-		else if (!Search::searching && cmd == "go") {
+		else if (cmd == "go") {
+			worker.wait_finished(); // a previous search that was just stopped
 			limits lims;
 			memset(&lims, 0, sizeof(limits));
 
@@ -181,7 +282,7 @@ bool uci::parse_command(const std::string& input) {
 				else if (cmd == "mate" && instream >> cmd) lims.mate = atoi(cmd.c_str());
 				else if (cmd == "depth" && instream >> cmd) lims.depth = atoi(cmd.c_str());
 				else if (cmd == "infinite") lims.infinite = (cmd == "infinite" ? true : false);
-				else if (cmd == "ponder") lims.ponder = atoi(cmd.c_str());
+				else if (cmd == "ponder") lims.ponder = true;
 			}
 
 			// Set search threads
@@ -190,10 +291,19 @@ bool uci::parse_command(const std::string& input) {
 				SearchThreads.init(numThreads);
 
 			bool silent = false;
+			UCI_SIGNALS.stop = false;
+			UCI_SIGNALS.ponder_hit = false;
+			SearchThreads.set_ponder(lims.ponder); // searches the expected reply until ponderhit or stop
+			ttable.new_search();
 			worker.enqueue(Search::start, uci_pos, lims, silent);
 		}
 		else if (cmd == "stop") {
 			UCI_SIGNALS.stop = true;
+			SearchThreads.stop();
+		}
+		else if (cmd == "ponderhit") {
+			UCI_SIGNALS.ponder_hit = true;
+			SearchThreads.ponderhit();
 		}
 		else if (cmd == "moves") {
 			Movegen mvs(uci_pos);
@@ -208,14 +318,22 @@ bool uci::parse_command(const std::string& input) {
 		else if (cmd == "ucinewgame") {
 			ttable.clear();
 			uci_pos.clear();
+			uci_loaded = {};
 		}
 		else if (cmd == "uci") {
 			ttable.clear();
 			uci_pos.clear();
+			uci_loaded = {};
 			std::cout << "id name haVoc" << std::endl;
 			std::cout << "id author M.Glatzmaier" << std::endl;
 			std::cout << "option name Threads type spin default 1 min 1 max 1024" << std::endl;
 			std::cout << "option name Hash type spin default 1024 min 1 max 33554432" << std::endl;
+			std::cout << "option name Ponder type check default false" << std::endl;
+			std::cout << "option name HugePages type check default true" << std::endl;
+			std::cout << "option name ThreadBinding type check default false" << std::endl;
+			std::cout << "option name HashSegment type string default <empty>" << std::endl;
+			std::cout << "option name LocalHash type spin default 0 min 0 max 65536" << std::endl;
+			std::cout << "option name LocalHashDepth type spin default 2 min 0 max 16" << std::endl;
 			std::cout << "option name MultiPV type spin default 1 min 1 max 4" << std::endl;
 			std::cout << "uciok" << std::endl;
 		}
@@ -231,40 +349,60 @@ bool uci::parse_command(const std::string& input) {
 }
 
 
-void uci::load_position(const std::string& pos) {
-	std::string token;
-	std::istringstream ss(pos);
-
-	ss >> token; // eat the moves token
-	while (ss >> token) {
-		Movegen mvs(uci_pos);
-		mvs.generate<pseudo_legal, pieces>();
-		for (int j = 0; j < mvs.size(); ++j) {
-			if (!uci_pos.is_legal(mvs[j])) continue;
-
-			if (move_to_string(mvs[j]) == token) {
-				uci_pos.do_move(mvs[j]);
-				break;
-			}
+// Only the moves the GUI appended since the last command are played, the
+// earlier ones stay on the board with their repetition history.
+void uci::load_position(const Notation::PositionCommand& cmd) {
+	int first = Notation::resume_from(uci_loaded, cmd);
+	if (first < 0) {
+		std::istringstream fen(cmd.start == "startpos" ? START_FEN : cmd.start);
+		uci_pos.setup(fen);
+		first = 0;
+	}
 
+	uci_loaded.start = cmd.start;
+	uci_loaded.moves.assign(cmd.moves.begin(), cmd.moves.begin() + first);
+	for (size_t i = first; i < cmd.moves.size(); ++i) {
+		Move m;
+		if (!parse_move(cmd.moves[i], m)) {
+			std::cout << "info string illegal move " << cmd.moves[i] << ", ignoring the rest" << std::endl;
+			return;
 		}
+		uci_pos.do_move(m);
+		uci_loaded.moves.push_back(cmd.moves[i]);
 	}
+}
 
+// Squares and promotion come from the text. The generated moves are only
+// compared by number to find the move type (capture, castle, en passant) and
+// legality is checked for the match alone, no strings are built.
+bool uci::parse_move(const std::string& token, Move& m) {
+	Notation::UciMove um;
+	if (!Notation::parse_move(token, um))
+		return false;
+
+	Movegen mvs(uci_pos);
+	mvs.generate<pseudo_legal, pieces>();
+	for (int j = 0; j < mvs.size(); ++j) {
+		if (mvs[j].f != um.from || mvs[j].t != um.to || promotion_of(mvs[j]) != um.promote)
+			continue;
+		if (!uci_pos.is_legal(mvs[j]))
+			return false;
+		m = mvs[j];
+		return true;
+	}
+	return false;
 }
 
-std::string uci::move_to_string(const Move& m) {
-	auto fromto = SanSquares[m.f] + SanSquares[m.t];
-	Movetype t = Movetype(m.type);
-
-	auto ps = (t == capture_promotion_q ? "q" :
-		t == capture_promotion_r ? "r" :
-		t == capture_promotion_b ? "b" :
-		t == capture_promotion_n ? "n" :
-		t == promotion_q ? "q" :
-		t == promotion_r ? "r" :
-		t == promotion_b ? "b" :
-		t == promotion_n ? "n" : "");
-
-	return fromto + ps;
+PieceType_t uci::promotion_of(const Move& m) {
+	switch (Movetype(m.type)) {
+	case promotion_q: case capture_promotion_q: return Piece::QUEEN;
+	case promotion_r: case capture_promotion_r: return Piece::ROOK;
+	case promotion_b: case capture_promotion_b: return Piece::BISHOP;
+	case promotion_n: case capture_promotion_n: return Piece::KNIGHT;
+	default: return Piece::NONE;
+	}
 }
 
+std::string uci::move_to_string(const Move& m) {
+	return Notation::to_string({ uint8(m.f), uint8(m.t), promotion_of(m) });
+}
@@ -8,9 +8,11 @@
 #include <cstring>
 #include <stdio.h>
 #include <algorithm>
+#include <atomic>
 #include <string>
 
 #include "bits.h"
+#include "notation.h"
 #include "types.h"
 
 struct Move;
@@ -23,14 +25,17 @@ struct limits {
 	bool infinite, ponder;
 };
 
+// Set by the UCI and timer threads, polled by the search threads
 struct signals {
-	volatile bool stop, ponder_hit, times_up;
+	std::atomic_bool stop, ponder_hit, times_up;
 };
 
 namespace uci {
 	void loop();
 	bool parse_command(const std::string& input);
-	void load_position(const std::string& pos);
+	void load_position(const Notation::PositionCommand& cmd);
+	bool parse_move(const std::string& token, Move& m); // legal in the loaded position
+	PieceType_t promotion_of(const Move& m);
 	std::string move_to_string(const Move& m);
 }
 
@@ -37,8 +37,8 @@ inline std::vector<std::string> split(const std::string& s, char delimiter) {
 
 constexpr int row(int square) { return square >> 3; }
 constexpr int col(int square) { return square & 7; }
-constexpr int row_dist(int s1, int s2) { return abs(row(s1) - row(s2)); }
-constexpr int col_dist(int s1, int s2) { return abs(col(s1) - col(s2)); }
+constexpr int row_dist(int s1, int s2) { return row(s1) > row(s2) ? row(s1) - row(s2) : row(s2) - row(s1); }
+constexpr int col_dist(int s1, int s2) { return col(s1) > col(s2) ? col(s1) - col(s2) : col(s2) - col(s1); }
 constexpr bool on_board(int square) { return square >= 0 && square <= 63; }
 constexpr bool same_row(int s1, int s2) { return row(s1) == row(s2); }
 constexpr bool same_col(int s1, int s2) { return col(s1) == col(s2); }
@@ -65,6 +65,21 @@ constexpr uint64 squares_behind(uint64 col_bb, ColorType_t color, int square) {
     return ~squares_infront(col_bb, color, square) & col_bb;
 }
 
+//=== Math Functions =====================================================
+
+// Natural log (x > 0) usable in constant expressions, std::log is not constexpr in C++20.
+// x = m * 2^k with m in [1, 2), ln(m) = 2 * atanh((m - 1) / (m + 1)).
+constexpr double ln(double x) {
+    int k = 0;
+    while (x >= 2.0) { x /= 2.0; ++k; }
+    while (x < 1.0) { x *= 2.0; --k; }
+    double z = (x - 1.0) / (x + 1.0);
+    double term = z, sum = 0.0;
+    for (int n = 1; n < 64; n += 2, term *= z * z)
+        sum += term / n;
+    return 2.0 * sum + k * 0.693147180559945309417232121458;
+}
+
 //=== Random Number Generator =============================================
 
 template <typename T>
@@ -4,12 +4,77 @@
 
 namespace Zobrist
 {
-    uint64 piece_rands[Square::TOTAL][2][Piece::TOTAL];
-    uint64 castle_rands[2][16];
-    uint64 ep_rands[8];
-    uint64 stm_rands[2];
-    uint64 move50_rands[512];
-    uint64 hmv_rands[512];
+    // Keys are laid out in zobrist_rands as: pieces [sq][color][piece], castle rights [color][bit],
+    // en-passant columns, side to move, then interleaved (move50, half move) pairs.
+    constexpr unsigned int CASTLE_IDX = Square::TOTAL * 2 * Piece::TOTAL;
+    constexpr unsigned int EP_IDX = CASTLE_IDX + 2 * 16;
+    constexpr unsigned int STM_IDX = EP_IDX + Col::TOTAL;
+    constexpr unsigned int MOVE50_IDX = STM_IDX + 2;
+
+    constexpr auto piece_rands = []
+    {
+        std::array<std::array<std::array<uint64, Piece::TOTAL>, 2>, Square::TOTAL> pr{};
+        unsigned int idx = 0;
+        for (SquareType_t sq = Square::A1; sq <= Square::H8; ++sq)
+            for (ColorType_t c = Color::WHITE; c <= Color::BLACK; ++c)
+                for (PieceType_t p = Piece::PAWN; p <= Piece::KING; ++p, ++idx)
+                    pr[sq][c][p] = zobrist_rands[idx];
+        return pr;
+    }();
+
+    // castle rights
+    constexpr auto castle_rands = []
+    {
+        std::array<std::array<uint64, 16>, 2> cr{};
+        unsigned int idx = CASTLE_IDX;
+        for (ColorType_t c = Color::WHITE; c <= Color::BLACK; ++c)
+            for (int bit = 0; bit < 16; ++bit, ++idx)
+                cr[c][bit] = zobrist_rands[idx];
+        return cr;
+    }();
+
+    // ep
+    constexpr auto ep_rands = []
+    {
+        std::array<uint64, 8> ep{};
+        for (ColType_t col = Col::A; col <= Col::H; ++col)
+            ep[col] = zobrist_rands[EP_IDX + col];
+        return ep;
+    }();
+
+    // stm
+    constexpr std::array<uint64, 2> stm_rands = {zobrist_rands[STM_IDX], zobrist_rands[STM_IDX + 1]};
+
+    // 512 here represents the maximum number of half moves expected in any
+    // game of chess.
+    constexpr auto move50_rands = []
+    {
+        std::array<uint64, 512> mr{};
+        for (int m = 0; m < 512; ++m)
+            mr[m] = zobrist_rands[MOVE50_IDX + 2 * m];
+        return mr;
+    }();
+
+    constexpr auto hmv_rands = []
+    {
+        std::array<uint64, 512> hr{};
+        for (int m = 0; m < 512; ++m)
+            hr[m] = zobrist_rands[MOVE50_IDX + 2 * m + 1];
+        return hr;
+    }();
+}
+
+// FNV-1a over every key: changes whenever zobristrands.h is regenerated
+uint64 Zobrist::fingerprint()
+{
+    constexpr uint64 fp = []
+    {
+        uint64 h = 0xcbf29ce484222325ULL;
+        for (uint64 r : zobrist_rands)
+            h = (h ^ r) * 0x100000001b3ULL;
+        return h;
+    }();
+    return fp;
 }
 
 U64 Zobrist::GenerateKey(unsigned int bits, Util::Rand<uint32> &r)
@@ -22,77 +87,9 @@ U64 Zobrist::GenerateKey(unsigned int bits, Util::Rand<uint32> &r)
 
 const unsigned _bits = 25;
 
+// Keys are compile-time constants, kept so callers need not know.
 bool Zobrist::load()
 {
-
-    const unsigned int N = 1835;
-    std::vector<U64> rands;
-    Util::Rand<uint32> R;
-
-    // bool ok = true;
-    // unsigned count = 0;
-    // while (rands.size() < N) {
-
-    //  U64 rand = R.next(); // gen(bits, R);
-    //
-    //  // filter zobrist keys to be unique
-    //  // and favor smaller values (bits distributed near lower half)
-    //  if (bits::count(rand) > 4) continue;
-    //
-    //  U64 filter_low = (rand >> 20); // 0x000000FFFFFFFF;
-    //  if (bits::count(filter_low) >= 3) continue;
-
-    //  //U64 filter_high = (rand << 20); // 0xFFFFFFFF;
-    //  //if (bits::count(filter_high) <= 3) continue;
-
-    //  for (unsigned i = 0; i < rands.size(); ++i) {
-    //    ok = (rand != rands[i]);
-    //    if (!ok) break;
-    //  }
-    //
-    //  if (ok) {
-    //    count = ((count + 1) % 6 == 0 ? 0 : count + 1);
-    //    std::string eol((count != 0 ? "), " : "),\n"));
-    //    std::cout << "ULL(" << rand << eol;
-    //    rands.emplace_back(rand);
-    //  }
-
-    //}
-
-    // pieces
-    unsigned int idx = 0;
-    for (SquareType_t sq = Square::A1; sq <= Square::H8; ++sq) {
-        for (ColorType_t c = Color::WHITE; c <= Color::BLACK; ++c) {
-            for (PieceType_t p = Piece::PAWN; p <= Piece::KING; ++p, ++idx) {
-                piece_rands[sq][c][p] = zobrist_rands[idx];
-            }
-        }
-    }
-
-    // castle rights
-    for (ColorType_t c = Color::WHITE; c <= Color::BLACK; ++c) {
-        for (int bit = 0; bit < 16; ++bit, ++idx) {
-            castle_rands[(int)c][bit] = zobrist_rands[idx];
-        }
-    }
-
-    // ep
-    for (ColType_t col = Col::A; col <= Col::H; ++col, ++idx) {
-        ep_rands[col] = zobrist_rands[idx];
-    }
-
-    // stm
-    stm_rands[Color::WHITE] = zobrist_rands[idx++];
-    stm_rands[Color::BLACK] = zobrist_rands[idx++];
-
-    // 512 here represents the maximum number of half moves expected in any
-    // game of chess.
-    for (int m = 0; m < 512; ++m, idx += 2)
-    {
-        move50_rands[m] = zobrist_rands[idx];
-        hmv_rands[m] = zobrist_rands[idx + 1];
-    }
-
     return true;
 }
 
@@ -16,6 +16,23 @@ namespace Zobrist
     uint64 move50(uint16 count);
     uint64 half_move_clock(uint16 count);
 
+    // Key of the child position from the parent key and the move's deltas alone:
+    // side c moves p from -> to (becoming promoted, if not NONE) and captures
+    // captured on to, then the side to move flips. Castling-right and en passant
+    // changes are xor'ed in by the caller with castle() and en_passant(); as a
+    // prefetch address the key is good enough without them.
+    inline uint64 child_key(uint64 key, ColorType_t c, PieceType_t p, SquareType_t from, SquareType_t to,
+                            PieceType_t captured = Piece::NONE, PieceType_t promoted = Piece::NONE)
+    {
+        key ^= piece(from, c, p) ^ piece(to, c, promoted == Piece::NONE ? p : promoted);
+        if (captured != Piece::NONE)
+            key ^= piece(to, c ^ 1, captured);
+        return key ^ side_to_move(Color::WHITE) ^ side_to_move(Color::BLACK);
+    }
+
+    // Identifies the key set, e.g. to reject hash files written with other keys
+    uint64 fingerprint();
+
     // Random Zobrist key generator
     uint64 GenerateKey(unsigned int bits, Util::Rand<uint32> &rng);
 
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <random>
+#include <utility>
+#include <vector>
+#include "hashtable.h"
+
+// Synthetic game tree with transpositions, the workload of the TT and SMP
+// benchmarks and of the bench and analyse harness tests: a child's key is the parent's xor a token of the side
+// to move, and move orders that play the same tokens reach the same key. TT hits
+// of sufficient depth cut the subtree.
+struct SyntheticTree {
+    static constexpr int branching = 6;
+    static constexpr int pool = 32;
+    uint64_t tokens[2][pool];
+
+    SyntheticTree() {
+        std::mt19937_64 rng(99);
+        for (auto &side : tokens)
+            for (auto &t : side)
+                t = rng();
+    }
+
+    uint64_t child(uint64_t key, int ply, int i) const { return key ^ tokens[ply & 1][(i + 5 * (ply >> 1)) % pool]; }
+
+    template <class Table>
+    int search(Table &tt, uint64_t key, int ply, int depth, int rotate, uint64_t &nodes, const std::atomic_bool &stop) const {
+        ++nodes;
+        hash_data e;
+        if (tt.fetch(key, e) && e.depth >= depth)
+            return e.score;
+        if (depth == 0 || stop)
+            return int(key & 0xFF);
+
+        int best = -1;
+        for (int i = 0; i < branching; ++i)
+            best = std::max(best, 255 - search(tt, child(key, ply, (i + rotate) % branching), ply + 1, depth - 1, rotate, nodes, stop));
+        if (stop)
+            return best; // partial result, keep it out of the table
+        Move m;
+        tt.save(key, uint8_t(depth), bound_exact, m, int16_t(best), 0, false);
+        return best;
+    }
+
+    // Best child (as Move::from) and score at depth
+    template <class Table>
+    std::pair<Move, int> root(Table &tt, uint64_t key, int depth, int rotate, uint64_t &nodes, const std::atomic_bool &stop) const {
+        std::pair<Move, int> best = {Move(), -1};
+        ++nodes;
+        for (int i = 0; i < branching; ++i) {
+            int c = (i + rotate) % branching;
+            int score = 255 - search(tt, child(key, 0, c), 1, depth - 1, rotate, nodes, stop);
+            if (score > best.second) {
+                best.first.set(uint8_t(c), 0, MoveType::QUIET);
+                best.second = score;
+            }
+        }
+        return best;
+    }
+
+    // Principal variation (child indices) read back from the entries a search of
+    // the root to depth left in the table; stops early where one was overwritten.
+    template <class Table>
+    std::vector<int> pv(Table &tt, uint64_t key, int depth) const {
+        std::vector<int> line;
+        for (int ply = 0; ply < depth; ++ply) {
+            int best = -1, best_i = -1;
+            for (int i = 0; i < branching; ++i) {
+                const uint64_t c = child(key, ply, i);
+                const int left = depth - ply - 1;
+                hash_data e;
+                int score;
+                if (left == 0)
+                    score = int(c & 0xFF);
+                else if (tt.fetch(c, e) && e.depth >= left)
+                    score = e.score;
+                else
+                    return line;
+                if (255 - score > best) {
+                    best = 255 - score;
+                    best_i = i;
+                }
+            }
+            line.push_back(best_i);
+            key = child(key, ply, best_i);
+        }
+        return line;
+    }
+};
@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <thread>
+#include <unistd.h>
+#include "analyse.h"
+#include "bench.h"
+#include "notation.h"
+#include "search.h"
+#include "synthetic_tree.h"
+#include "threads.h"
+
+namespace {
+    struct AnalysePosition {
+        uint64 key = 0;
+    };
+
+    const SyntheticTree tree;
+
+    std::string move_name(int child) { return "c" + std::to_string(child); }
+
+    // Stands in for the engine: iterative deepening of the synthetic tree rooted
+    // at the position's key, moves are child indices ("c3"). State is per worker.
+    struct SyntheticSearcher {
+        Analyse::Options opt;
+        hash_table table;
+        Search::ThreadData<AnalysePosition> td;
+        TimerThread timer;
+
+        SyntheticSearcher(unsigned int worker, const Analyse::Options &o)
+            : opt(o), table(o.worker_hash_mb()), td(worker, table, 0) {}
+
+        bool search(const Analyse::Record &rec, Analyse::Result &r) {
+            Notation::Fen f;
+            if (!Notation::parse_fen(rec.fen, f))
+                return false;
+            td.pos.key = Notation::key(f);
+            if (opt.clear_hash)
+                table.clear();
+            else
+                table.new_search();
+            td.history = {};
+
+            std::atomic_bool stop(false);
+            const auto start = std::chrono::steady_clock::now();
+            if (opt.limits.movetime > 0)
+                timer.arm(start + std::chrono::milliseconds(opt.limits.movetime), stop);
+            const int max_depth = opt.limits.depth > 0 ? opt.limits.depth : 64;
+            uint64_t nodes = 0;
+            for (int depth = 1; depth <= max_depth; ++depth) {
+                auto [move, score] = tree.root(td.tt, td.pos.key, depth, 0, nodes, stop);
+                if (stop && depth > 1)
+                    break; // partial iteration, keep the previous one
+                td.best_move = move;
+                td.best_score = score;
+                td.completed_depth = depth;
+                if (stop || (opt.limits.nodes && nodes >= opt.limits.nodes))
+                    break;
+            }
+            timer.cancel();
+
+            r.best = move_name(td.best_move.from);
+            r.score = td.best_score;
+            r.depth = td.completed_depth;
+            r.nodes = nodes;
+            for (int child : tree.pv(td.tt, td.pos.key, td.completed_depth))
+                r.pv.push_back(move_name(child));
+            r.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            return true;
+        }
+    };
+
+    Analyse::Searcher synthetic(unsigned int worker, const Analyse::Options &opt) {
+        auto s = std::make_shared<SyntheticSearcher>(worker, opt);
+        return [s](const Analyse::Record &rec, Analyse::Result &r) { return s->search(rec, r); };
+    }
+
+    std::string temp_file(const std::string &content) {
+        std::string path = "/tmp/nano_analyse_" + std::to_string(getpid()) + "_" + std::to_string(std::rand()) + ".epd";
+        std::ofstream(path) << content;
+        return path;
+    }
+
+    std::vector<std::string> lines_of(const std::string &s) {
+        std::vector<std::string> lines;
+        std::istringstream ss(s);
+        for (std::string l; std::getline(ss, l);)
+            lines.push_back(std::regex_replace(l, std::regex(",\"ms\":[0-9]+"), "")); // the only timing field
+        return lines;
+    }
+}
+
+class TestAnalyse : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() { }
+    static void TearDownTestSuite() { }
+};
+
+TEST_F(TestAnalyse, WorkerHash) {
+    Analyse::Options o;
+    o.hash_mb = 64;
+    o.threads = 8;
+    EXPECT_EQ(o.worker_hash_mb(), 8u);
+    o.threads = 128;
+    EXPECT_EQ(o.worker_hash_mb(), 1u);
+}
+
+TEST_F(TestAnalyse, ParseLine) {
+    Analyse::Record r;
+    ASSERT_TRUE(Analyse::parse_line("8/8/8/8/8/8/8/K6k w - - 12 40", r));
+    EXPECT_EQ(r.fen, "8/8/8/8/8/8/8/K6k w - - 12 40");
+    EXPECT_TRUE(r.id.empty());
+
+    ASSERT_TRUE(Analyse::parse_line("8/8/8/8/8/8/8/K6k b - - bm Kb2; id \"WAC.001\";", r));
+    EXPECT_EQ(r.fen, "8/8/8/8/8/8/8/K6k b - - 0 1");
+    EXPECT_EQ(r.id, "WAC.001");
+
+    ASSERT_TRUE(Analyse::parse_line("8/8/8/8/8/8/8/K6k w - -", r));
+    EXPECT_EQ(r.fen, "8/8/8/8/8/8/8/K6k w - - 0 1");
+    EXPECT_FALSE(Analyse::parse_line("8/8/8/8 w", r));
+}
+
+TEST_F(TestAnalyse, EpdFile) {
+    const std::string path = temp_file("# comment\n\nfirst line\r\n   second\n\n# x\nthird");
+    Analyse::EpdFile f;
+    ASSERT_TRUE(f.open(path));
+    size_t index;
+    std::string_view line;
+    std::vector<std::string> got;
+    while (f.next(index, line)) {
+        EXPECT_EQ(index, got.size());
+        got.emplace_back(line);
+    }
+    EXPECT_EQ(got, (std::vector<std::string>{"first line", "second", "third"}));
+    std::remove(path.c_str());
+
+    Analyse::EpdFile missing;
+    EXPECT_FALSE(missing.open("/nonexistent/positions.epd"));
+}
+
+TEST_F(TestAnalyse, OrderedOutput) {
+    std::ostringstream os;
+    Analyse::OrderedOutput out(os);
+    out.write(2, "c");
+    out.write(1, "b");
+    EXPECT_EQ(os.str(), "");
+    out.write(0, "a");
+    EXPECT_EQ(os.str(), "a\nb\nc\n");
+    EXPECT_EQ(out.written(), 3u);
+
+    // workers far ahead wait for the oldest position instead of piling up
+    std::thread ahead([&] { out.write(3 + Analyse::OrderedOutput::MAX_PENDING, "late"); });
+    for (size_t i = 4; i < 3 + Analyse::OrderedOutput::MAX_PENDING; ++i)
+        out.write(i, "x");
+    EXPECT_EQ(out.written(), 3u);
+    out.write(3, "first");
+    ahead.join();
+    EXPECT_EQ(out.written(), 4 + Analyse::OrderedOutput::MAX_PENDING);
+}
+
+// Results in input order and, from a cleared table, the same whatever the
+// thread count
+TEST_F(TestAnalyse, Run) {
+    std::string content = "not a position\n";
+    for (const std::string &fen : Bench::positions())
+        content += fen + "\n";
+    content += "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - bm Bb5; id \"ruy\";\n";
+    const std::string path = temp_file(content);
+
+    Analyse::Options o;
+    o.epd = path;
+    o.clear_hash = true;
+    o.limits.depth = 5;
+    std::vector<std::string> first;
+    for (unsigned int threads : {1u, 3u}) {
+        o.threads = threads;
+        std::ostringstream out, log;
+        Analyse::Summary s = Analyse::run(o, synthetic, out, log);
+        EXPECT_EQ(s.positions, 52u);
+        EXPECT_EQ(s.failed, 1u);
+        EXPECT_GT(s.nodes, 0u);
+
+        auto lines = lines_of(out.str());
+        ASSERT_EQ(lines.size(), 52u);
+        for (size_t i = 0; i < lines.size(); ++i)
+            EXPECT_EQ(lines[i].find("{\"index\":" + std::to_string(i) + ","), 0u) << lines[i];
+        EXPECT_NE(lines[0].find("\"error\""), std::string::npos);
+        EXPECT_NE(lines[1].find("\"depth\":5"), std::string::npos);
+        EXPECT_NE(lines[51].find("\"id\":\"ruy\""), std::string::npos);
+        if (first.empty()) {
+            first = lines;
+        } else {
+            EXPECT_EQ(lines, first);
+        }
+    }
+    std::remove(path.c_str());
+}
+
+// The node limit is checked between iterations
+TEST_F(TestAnalyse, Limits) {
+    const std::string path = temp_file(Bench::positions()[6] + "\n");
+    Analyse::Options o;
+    o.epd = path;
+    auto field = [&](const char *name) {
+        std::ostringstream out, log;
+        Analyse::run(o, synthetic, out, log);
+        std::smatch m;
+        const std::string s = out.str();
+        return std::regex_search(s, m, std::regex(std::string("\"") + name + "\":([0-9]+)")) ? std::stoull(m[1]) : 0ull;
+    };
+
+    o.limits.depth = 3;
+    const uint64 to_depth3 = field("nodes");
+    ASSERT_GT(to_depth3, 0u);
+    o.limits = Analyse::Limits{};
+    o.limits.nodes = to_depth3;
+    EXPECT_EQ(field("depth"), 3u);
+    o.limits.nodes = to_depth3 + 1;
+    EXPECT_EQ(field("depth"), 4u);
+
+    o.limits = Analyse::Limits{};
+    o.limits.movetime = 50;
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_GE(field("depth"), 1u);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_LT(ms, 200.0);
+    std::remove(path.c_str());
+}
+
+TEST_F(TestAnalyse, Throughput) {
+    std::string content;
+    for (int i = 0; i < 10; ++i)
+        for (const std::string &fen : Bench::positions())
+            content += fen + "\n";
+    const std::string path = temp_file(content);
+    Analyse::Options o;
+    o.epd = path;
+    o.limits.depth = 4;
+    for (unsigned int threads : {1u, 2u, 4u}) {
+        o.threads = threads;
+        std::ostringstream out, log;
+        Analyse::Summary s = Analyse::run(o, synthetic, out, log);
+        std::cout << "[Benchmark] analyse harness, synthetic tree, depth 4, " << threads << " threads: " << s.per_second() << " positions/s\n";
+    }
+    std::remove(path.c_str());
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <sstream>
+#include "bench.h"
+#include "notation.h"
+#include "search.h"
+#include "synthetic_tree.h"
+
+namespace {
+    struct BenchPosition {
+        uint64 key = 0;
+    };
+
+    const SyntheticTree tree;
+
+    // Stands in for the engine search: each position is the synthetic tree rooted
+    // at its Zobrist key, which exercises the driver, thread pool and table.
+    struct SyntheticBench {
+        hash_table table;
+        Search::SearchPool<BenchPosition> pool;
+        int depth;
+
+        explicit SyntheticBench(const Bench::Options &o) : table(o.hash_mb), depth(o.depth) { pool.init(o.threads, table); }
+
+        Bench::Report run(std::ostream &os) {
+            auto iterate = [](Search::ThreadData<BenchPosition> &td, int d, const std::atomic_bool &stop) {
+                uint64_t nodes = 0;
+                auto r = tree.root(td.tt, td.pos.key, d, int(td.id), nodes, stop);
+                td.nodes += nodes;
+                return r;
+            };
+            return Bench::run([&](const std::string &fen) {
+                Notation::Fen f;
+                Notation::parse_fen(fen, f);
+                table.clear();
+                return pool.search(BenchPosition{Notation::key(f)}, depth, iterate).nodes;
+            }, os);
+        }
+    };
+}
+
+class TestBench : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() { }
+    static void TearDownTestSuite() { }
+};
+
+TEST_F(TestBench, Suite) {
+    const auto &suite = Bench::positions();
+    EXPECT_EQ(suite.size(), 50u);
+    std::set<uint64> keys;
+    for (const std::string &fen : suite) {
+        Notation::Fen f;
+        EXPECT_TRUE(Notation::parse_fen(fen, f)) << fen;
+        keys.insert(Notation::key(f));
+    }
+    EXPECT_EQ(keys.size(), suite.size());
+}
+
+TEST_F(TestBench, Parse) {
+    Bench::Options o = Bench::parse({});
+    EXPECT_EQ(o.depth, Bench::Options().depth);
+    EXPECT_EQ(o.threads, 1u);
+
+    o = Bench::parse({"7", "4", "64"});
+    EXPECT_EQ(o.depth, 7);
+    EXPECT_EQ(o.threads, 4u);
+    EXPECT_EQ(o.hash_mb, 64u);
+
+    o = Bench::parse({"x", "0"});
+    EXPECT_EQ(o.depth, Bench::Options().depth);
+    EXPECT_EQ(o.threads, 1u);
+}
+
+// Single threaded the node count is a signature, equal on every run
+TEST_F(TestBench, Signature) {
+    Bench::Options o;
+    o.depth = 4;
+    std::ostringstream log;
+    SyntheticBench bench(o);
+    Bench::Report a = bench.run(log);
+    Bench::Report b = bench.run(log);
+    EXPECT_EQ(a.positions, 50u);
+    EXPECT_GT(a.nodes, 0u);
+    EXPECT_EQ(a.nodes, b.nodes);
+    EXPECT_EQ(log.str().find("invalid"), std::string::npos);
+
+    std::ostringstream out;
+    a.print(out);
+    EXPECT_NE(out.str().find("Nodes searched  : " + std::to_string(a.nodes)), std::string::npos);
+}
+
+TEST_F(TestBench, Speed) {
+    std::ostringstream log;
+    for (unsigned int threads : {1u, 4u}) {
+        Bench::Options o;
+        o.depth = 5;
+        o.threads = threads;
+        Bench::Report r = SyntheticBench(o).run(log);
+        std::cout << "[Benchmark] bench harness, synthetic tree, depth " << o.depth << ", " << threads << " threads: " << r.nodes << " nodes, "
+                  << r.ms << " ms, " << r.nps() << " nps\n";
+    }
+}
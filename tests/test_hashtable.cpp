@@ -0,0 +1,556 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "bench.h"
+#include "hashtable.h"
+#include "memory.h"
+#include "notation.h"
+#include "threads.h"
+#include "zobrist.h"
+#include "synthetic_tree.h"
+
+class TestHashTable : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() { }
+    static void TearDownTestSuite() { }
+};
+
+TEST_F(TestHashTable, HugePageBlockIsAligned) {
+    for (bool huge : {false, true}) {
+        Memory::Block b = Memory::alloc(3 * 1024 * 1024 + 100, huge);
+        ASSERT_NE(b.ptr, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(b.ptr) % 64, 0u);
+        EXPECT_GE(b.bytes, size_t(3 * 1024 * 1024 + 100));
+        const char *p = static_cast<const char *>(b.ptr);
+        if (b.mapped) {
+            EXPECT_TRUE(std::all_of(p, p + b.bytes, [](char c) { return c == 0; }));
+        }
+        if (!huge) {
+            EXPECT_EQ(b.pages, Memory::Pages::NORMAL);
+        }
+        std::cout << "[Benchmark] " << (huge ? "huge" : "normal") << " page block: " << Memory::describe(b) << "\n";
+        Memory::release(b);
+        EXPECT_EQ(b.ptr, nullptr);
+    }
+}
+
+TEST_F(TestHashTable, SaveFetchWithAndWithoutHugePages) {
+    hash_table tt;
+    Move m;
+    m.set(12, 28, MoveType::QUIET);
+
+    for (bool huge : {true, false}) {
+        tt.set_huge_pages(huge);
+        tt.resize(16);
+        std::cout << "[Benchmark] hash table (huge pages " << (huge ? "on" : "off") << "): " << tt.page_info() << "\n";
+
+        std::mt19937_64 rng(42);
+        std::vector<uint64_t> keys(1000);
+        for (auto &k : keys) {
+            k = rng();
+            tt.save(k, 5, bound_exact, m, 100, 0, false);
+        }
+        size_t found = 0;
+        for (auto &k : keys) {
+            hash_data e;
+            if (tt.fetch(k, e)) {
+                ++found;
+                EXPECT_EQ(e.move, m);
+                EXPECT_EQ(e.bound, bound_exact);
+            }
+        }
+        EXPECT_GT(found, keys.size() * 9 / 10);
+    }
+}
+
+TEST_F(TestHashTable, ClearRemovesEntries) {
+    hash_table tt;
+    Move m;
+    m.set(12, 28, MoveType::QUIET);
+    ThreadPool<WorkerThread> pool(3);
+    for (ThreadPool<WorkerThread> *threads : {static_cast<ThreadPool<WorkerThread> *>(nullptr), &pool}) {
+        tt.set_threads(threads);
+        tt.resize(16);
+        for (uint64_t k = 1; k < 5000; ++k)
+            tt.save(k * 0x9E3779B97F4A7C15ULL, 5, bound_exact, m, 100, 0, false);
+        tt.clear();
+        hash_data e;
+        for (uint64_t k = 1; k < 5000; ++k)
+            EXPECT_FALSE(tt.fetch(k * 0x9E3779B97F4A7C15ULL, e));
+    }
+}
+
+// A size that cannot be allocated leaves the old table and its entries
+TEST_F(TestHashTable, FailedResizeKeepsTable) {
+    hash_table tt;
+    Move m;
+    m.set(12, 28, MoveType::QUIET);
+    ASSERT_TRUE(tt.resize(16));
+    const std::string before = tt.page_info();
+    tt.save(0x9E3779B97F4A7C15ULL, 5, bound_exact, m, 100, 0, false);
+
+    EXPECT_FALSE(tt.resize(size_t(1) << 30)); // a petabyte
+    EXPECT_EQ(tt.page_info(), before);
+    hash_data e;
+    EXPECT_TRUE(tt.fetch(0x9E3779B97F4A7C15ULL, e));
+    EXPECT_TRUE(tt.resize(8));
+}
+
+TEST_F(TestHashTable, ClearThroughput) {
+    hash_table tt;
+    const size_t mb = 512;
+    const unsigned int hw = std::max(4u, std::thread::hardware_concurrency());
+    for (unsigned int threads : {1u, hw}) {
+        ThreadPool<WorkerThread> pool(threads);
+        tt.set_threads(&pool);
+        tt.resize(mb);
+        auto start = std::chrono::steady_clock::now();
+        for (int rep = 0; rep < 4; ++rep)
+            tt.clear();
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "[Benchmark] TT clear (" << threads << " threads): " << 4.0 * mb / 1024 / s << " GB/s\n";
+        tt.set_threads(nullptr);
+    }
+}
+
+TEST_F(TestHashTable, EntryRoundTrip) {
+    hash_table tt;
+    tt.resize(1);
+    tt.new_search();
+    tt.new_search();
+    Move m;
+    m.set(52, 60, MoveType::PROMOTE_Q);
+    tt.save(0x123456789ABCDEFULL, 17, bound_low, m, -321, 45, true);
+
+    hash_data e;
+    ASSERT_TRUE(tt.fetch(0x123456789ABCDEFULL, e));
+    EXPECT_EQ(e.move, m);
+    EXPECT_EQ(int(e.depth), 17);
+    EXPECT_EQ(e.bound, bound_low);
+    EXPECT_EQ(e.score, -321);
+    EXPECT_EQ(e.eval, 45);
+    EXPECT_TRUE(e.pv);
+    EXPECT_EQ(e.age, tt.current_generation());
+    EXPECT_EQ(tt.current_generation(), 2);
+}
+
+// With a full cluster, entries from older searches go first, then the shallowest
+TEST_F(TestHashTable, ReplacesStaleBeforeDeep) {
+    hash_table tt;
+    tt.resize(1);
+    Move m;
+    std::vector<uint64_t> same = {0x4000000000000001ULL}; // keys of one cluster
+    for (uint64_t k = same[0] + 1; same.size() < 8; ++k)
+        if (tt.first_entry(k) == tt.first_entry(same[0]))
+            same.push_back(k);
+    auto key = [&](uint64_t i) { return same[i - 1]; };
+
+    tt.save(key(1), 30, bound_exact, m, 0, 0, false);
+    tt.new_search();
+    for (uint64_t i = 2; i <= 5; ++i)
+        tt.save(key(i), uint8_t(8 + i), bound_exact, m, 0, 0, false);
+    tt.save(key(6), 3, bound_exact, m, 0, 0, false);
+
+    hash_data e;
+    tt.save(key(7), 6, bound_exact, m, 0, 0, false); // evicts the shallow entry of this search
+    EXPECT_FALSE(tt.fetch(key(6), e));
+    EXPECT_TRUE(tt.fetch(key(1), e));
+
+    for (int i = 0; i < 4; ++i)
+        tt.new_search();
+    for (uint64_t i = 2; i <= 5; ++i)
+        tt.save(key(i), uint8_t(8 + i), bound_exact, m, 0, 0, false);
+    tt.save(key(7), 6, bound_exact, m, 0, 0, false);
+    tt.save(key(8), 2, bound_exact, m, 0, 0, false); // depth 30 from five searches ago is now worth least
+    EXPECT_FALSE(tt.fetch(key(1), e));
+    EXPECT_TRUE(tt.fetch(key(2), e));
+    EXPECT_TRUE(tt.fetch(key(8), e));
+}
+
+// The same position keeps its move when a later save has none
+TEST_F(TestHashTable, KeepsMoveOfSamePosition) {
+    hash_table tt;
+    tt.resize(3); // not a power of two
+    Move m, none;
+    m.set(6, 21, MoveType::QUIET);
+    tt.save(0xDEADBEEFCAFEULL, 4, bound_low, m, 10, 0, false);
+    tt.save(0xDEADBEEFCAFEULL, 6, bound_high, none, 20, 0, false);
+    hash_data e;
+    ASSERT_TRUE(tt.fetch(0xDEADBEEFCAFEULL, e));
+    EXPECT_EQ(e.move, m);
+    EXPECT_EQ(int(e.depth), 6);
+    EXPECT_EQ(e.score, 20);
+}
+
+// Synthetic searches over a skewed key space far larger than the table: shallow
+// nodes are common and new, deep nodes near the root are few and recur across searches.
+TEST_F(TestHashTable, Efficiency) {
+    hash_table tt;
+    tt.resize(2);
+    const size_t nodes = 400000, searches = 8, universe = 4000000;
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    Move m;
+
+    size_t probes = 0, hits = 0;
+    double hit_depth = 0.0;
+    for (size_t s = 0; s < searches; ++s) {
+        tt.new_search();
+        for (size_t n = 0; n < nodes; ++n) {
+            size_t idx = size_t(universe * std::pow(u(rng), 4.0));
+            int depth = std::max(0, 20 - int(std::log2(double(idx) + 1.0)));
+            uint64_t k = (idx + s * (idx > 100000 ? universe : 0)) * 0x9E3779B97F4A7C15ULL;
+
+            hash_data e;
+            ++probes;
+            if (tt.fetch(k, e)) {
+                ++hits;
+                hit_depth += e.depth;
+            }
+            tt.save(k, uint8_t(depth), bound_exact, m, 0, 0, depth > 15);
+        }
+    }
+    EXPECT_GT(hits, 0u);
+    std::cout << "[Benchmark] TT efficiency: " << 100.0 * hits / probes << "% hit rate, "
+              << hit_depth / std::max<size_t>(hits, 1) << " mean depth of hits ("
+              << searches << " searches x " << nodes << " nodes, 2 MB)\n";
+}
+
+// The incremental child key equals the key recomputed from scratch
+TEST_F(TestHashTable, ChildKeyMatchesFullKey) {
+    struct PieceOn { SquareType_t s; ColorType_t c; PieceType_t p; };
+    auto full_key = [](const std::vector<PieceOn> &pieces, ColorType_t stm) {
+        uint64_t k = Zobrist::side_to_move(stm);
+        for (auto &x : pieces)
+            k ^= Zobrist::piece(x.s, x.c, x.p);
+        return k;
+    };
+
+    // white knight g1xf3 capturing a black bishop, then a white pawn e7-e8=Q
+    std::vector<PieceOn> before = {{Square::G1, Color::WHITE, Piece::KNIGHT}, {Square::F3, Color::BLACK, Piece::BISHOP},
+                                   {Square::E7, Color::WHITE, Piece::PAWN}};
+    std::vector<PieceOn> after_capture = {{Square::F3, Color::WHITE, Piece::KNIGHT}, {Square::E7, Color::WHITE, Piece::PAWN}};
+    std::vector<PieceOn> after_promo = {{Square::G1, Color::WHITE, Piece::KNIGHT}, {Square::F3, Color::BLACK, Piece::BISHOP},
+                                        {Square::E8, Color::WHITE, Piece::QUEEN}};
+
+    uint64_t parent = full_key(before, Color::WHITE);
+    EXPECT_EQ(Zobrist::child_key(parent, Color::WHITE, Piece::KNIGHT, Square::G1, Square::F3, Piece::BISHOP),
+              full_key(after_capture, Color::BLACK));
+    EXPECT_EQ(Zobrist::child_key(parent, Color::WHITE, Piece::PAWN, Square::E7, Square::E8, Piece::NONE, Piece::QUEEN),
+              full_key(after_promo, Color::BLACK));
+}
+
+// Keys of real positions (the bench suite and a move from each of its pieces)
+// spread over the clusters and the local slots, like the random keys above.
+TEST_F(TestHashTable, RealKeysSpread) {
+    std::vector<uint64_t> keys;
+    for (const std::string &fen : Bench::positions()) {
+        Notation::Fen f;
+        ASSERT_TRUE(Notation::parse_fen(fen, f)) << fen;
+        const uint64_t key = Notation::key(f);
+        keys.push_back(key);
+        for (int sq = 0; sq < 64; ++sq)
+            if (f.piece[sq] != Piece::NONE && f.color[sq] == f.side)
+                keys.push_back(Zobrist::child_key(key, f.side, f.piece[sq], sq, sq ^ 8));
+    }
+
+    hash_table tt(16);
+    std::vector<const entry *> clusters;
+    for (uint64_t k : keys)
+        clusters.push_back(tt.first_entry(k));
+    std::sort(clusters.begin(), clusters.end());
+    const size_t distinct = size_t(std::unique(clusters.begin(), clusters.end()) - clusters.begin());
+    EXPECT_GT(distinct, keys.size() * 95 / 100) << distinct << " clusters for " << keys.size() << " keys";
+
+    tiered_table local(tt);
+    Move m;
+    m.set(12, 28, MoveType::QUIET);
+    for (uint64_t k : keys)
+        local.save(k, 1, bound_exact, m, 7, 0, false);
+    size_t hits = 0;
+    hash_data e;
+    for (uint64_t k : keys)
+        hits += local.fetch(k, e);
+    EXPECT_GT(hits, keys.size() * 90 / 100) << hits << " of " << keys.size() << " shallow entries kept";
+}
+
+// Probe latency on a table far larger than the LLC, with the prefetch issued
+// before ~100 ns of unrelated work (standing in for move ordering) or not at all.
+TEST_F(TestHashTable, PrefetchLatency) {
+    hash_table tt;
+    tt.resize(512);
+    const size_t probes = 200000;
+    std::mt19937_64 rng(11);
+    std::vector<uint64_t> keys(probes);
+    for (auto &k : keys)
+        k = rng();
+
+    auto work = [](uint64_t x) {
+        for (int i = 0; i < 64; ++i)
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        return x;
+    };
+
+    for (bool early : {false, true}) {
+        uint64_t sink = 0ULL;
+        hash_data e;
+        auto start = std::chrono::steady_clock::now();
+        for (auto &k : keys) {
+            if (early)
+                tt.prefetch(k);
+            sink ^= work(k);
+            sink += tt.fetch(k, e);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / probes;
+        EXPECT_NE(sink, 1ULL);
+        std::cout << "[Benchmark] TT probe + work (" << (early ? "early prefetch" : "no prefetch") << "): " << ns << " ns\n";
+    }
+}
+
+TEST_F(TestHashTable, HashfullAndStats) {
+    hash_table tt;
+    tt.resize(1);
+    EXPECT_EQ(tt.hashfull(), 0);
+    hash_table::reset_stats();
+
+    Move m;
+    std::mt19937_64 rng(3);
+    for (int i = 0; i < 200000; ++i) {
+        uint64_t k = rng();
+        hash_data e;
+        if (!tt.fetch(k, e))
+            tt.save(k, uint8_t(k % 20), bound_exact, m, 0, 0, false);
+    }
+    EXPECT_GT(tt.hashfull(), 900);
+    tt.new_search();
+    EXPECT_EQ(tt.hashfull(), 0); // nothing written in this generation yet
+
+    std::ostringstream os;
+    tt.dump_stats(os);
+    EXPECT_NE(os.str().find("depth histogram"), std::string::npos);
+    EXPECT_NE(os.str().find("age histogram"), std::string::npos);
+
+    tt_counters c = hash_table::stats();
+#ifdef NANO_TT_STATS
+    EXPECT_EQ(c.n[stat_probes], 200000u);
+    EXPECT_EQ(c.n[stat_stores], c.n[stat_probes] - c.n[stat_hits]);
+    EXPECT_EQ(c.n[stat_stores], c.n[stat_skipped] + c.n[stat_replace_empty] + c.n[stat_replace_same] +
+                                c.n[stat_replace_aged] + c.n[stat_replace_shallow]);
+    EXPECT_LE(c.n[stat_replace_empty], size_t(1024 * 1024 / 64 * cluster_size));
+#else
+    EXPECT_EQ(c.n[stat_probes], 0u);
+#endif
+}
+
+TEST_F(TestHashTable, SaveAndLoadFile) {
+    const std::string path = ::testing::TempDir() + "nano_hash_test.bin";
+    Move m;
+    m.set(1, 18, MoveType::QUIET);
+    std::mt19937_64 rng(5);
+    std::vector<uint64_t> keys(5000);
+
+    {
+        hash_table tt;
+        tt.resize(3);
+        tt.new_search();
+        for (auto &k : keys) {
+            k = rng();
+            tt.save(k, 9, bound_high, m, -77, 12, false);
+        }
+        ASSERT_TRUE(tt.save_to(path));
+    }
+
+    hash_table loaded;
+    loaded.resize(1);
+    ASSERT_TRUE(loaded.load_from(path));
+    EXPECT_EQ(loaded.current_generation(), 1);
+    std::cout << "[Benchmark] loaded hash: " << loaded.page_info() << "\n";
+
+    size_t found = 0;
+    for (auto &k : keys) {
+        hash_data e;
+        if (loaded.fetch(k, e)) {
+            ++found;
+            EXPECT_EQ(e.move, m);
+            EXPECT_EQ(e.score, -77);
+        }
+    }
+    EXPECT_GT(found, keys.size() * 9 / 10);
+
+    // copy-on-write: updating the loaded table leaves the file alone
+    loaded.clear();
+    hash_table again;
+    ASSERT_TRUE(again.load_from(path));
+    hash_data e;
+    EXPECT_TRUE(again.fetch(keys[0], e));
+
+    // truncated and foreign files are rejected
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::in);
+        out.seekp(0);
+        out.write("XXXX", 4);
+    }
+    EXPECT_FALSE(again.load_from(path));
+    EXPECT_FALSE(again.load_from(path + ".missing"));
+    std::remove(path.c_str());
+}
+
+// Two forked processes attach to one segment by name: the first stores, the
+// second must find every entry, and the parent sees the second's stores and
+// the generation it advanced.
+TEST_F(TestHashTable, SharedAcrossProcesses) {
+    const std::string name = "/nano_tt_test_" + std::to_string(getpid());
+    hash_table::remove_shared(name);
+    Move m;
+    m.set(10, 26, MoveType::QUIET);
+    std::vector<uint64_t> first(2000), second(2000);
+    std::mt19937_64 rng(17);
+    for (auto &k : first) k = rng();
+    for (auto &k : second) k = rng();
+
+    auto run_child = [&](auto body) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            hash_table tt;
+            tt.resize(4);
+            _exit(tt.set_shared(name) && tt.shared() == name ? body(tt) : 2);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    };
+
+    EXPECT_EQ(run_child([&](hash_table &tt) {
+        for (auto &k : first)
+            tt.save(k, 7, bound_exact, m, 33, 0, false);
+        return 0;
+    }), 0);
+
+    EXPECT_EQ(run_child([&](hash_table &tt) {
+        int misses = 0;
+        hash_data e;
+        for (auto &k : first)
+            misses += !(tt.fetch(k, e) && e.move == m && e.score == 33);
+        tt.new_search();
+        tt.new_search();
+        for (auto &k : second)
+            tt.save(k, 8, bound_exact, m, 44, 0, false);
+        return misses ? 1 : 0;
+    }), 0);
+
+    hash_table tt;
+    tt.resize(1); // joins at the creator's size
+    ASSERT_TRUE(tt.set_shared(name));
+    std::cout << "[Benchmark] shared hash: " << tt.page_info() << "\n";
+    size_t hits = 0;
+    hash_data e;
+    for (auto &k : second)
+        hits += tt.fetch(k, e) && e.score == 44 && e.age == 2;
+    EXPECT_EQ(hits, second.size());
+    EXPECT_EQ(tt.current_generation(), 2);
+    EXPECT_GT(tt.hashfull(), 0);
+
+    EXPECT_TRUE(tt.set_shared(""));
+    EXPECT_FALSE(tt.fetch(second[0], e));
+    EXPECT_TRUE(hash_table::remove_shared(name));
+}
+
+// A process joining the segment sends uci/ucinewgame like any engine, and the
+// clear that follows must not wipe the entries or the aging of the others
+TEST_F(TestHashTable, JoinerClearKeepsSharedEntries) {
+    const std::string name = "/nano_tt_clear_" + std::to_string(getpid());
+    hash_table::remove_shared(name);
+    Move m;
+    m.set(10, 26, MoveType::QUIET);
+
+    hash_table first(4);
+    ASSERT_TRUE(first.set_shared(name));
+    first.new_search();
+    first.save(0x9E3779B97F4A7C15ULL, 9, bound_exact, m, 21, 0, false);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        hash_table joiner(1);
+        if (!joiner.set_shared(name))
+            _exit(2);
+        joiner.clear();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+
+    hash_data e;
+    EXPECT_TRUE(first.fetch(0x9E3779B97F4A7C15ULL, e));
+    EXPECT_EQ(e.score, 21);
+    EXPECT_EQ(first.current_generation(), 1);
+
+    EXPECT_TRUE(first.set_shared(""));
+    EXPECT_TRUE(hash_table::remove_shared(name));
+}
+
+// Lazy-SMP style: every thread deepens the same tree (in a different move order)
+// over one shared table; the run ends when the first thread completes the depth.
+TEST_F(TestHashTable, TieredTableSpeed) {
+    const SyntheticTree tree;
+    const int depth = 8;
+
+    for (unsigned int threads : {1u, 8u, 32u}) {
+        for (size_t local_bytes : {size_t(0), size_t(256 * 1024)}) {
+            hash_table shared;
+            shared.resize(1);
+            shared.new_search();
+            std::atomic_bool stop(false);
+            std::atomic<uint64_t> total_nodes(0);
+
+            auto start = std::chrono::steady_clock::now();
+            {
+                std::vector<WorkerThread> workers;
+                for (unsigned int t = 0; t < threads; ++t)
+                    workers.emplace_back([&, t] {
+                        tiered_table tt(shared, local_bytes, 2);
+                        uint64_t nodes = 0;
+                        for (int d = 1; d <= depth && !stop; ++d)
+                            tree.search(tt, 0x1234ULL, 0, d, int(t), nodes, stop);
+                        stop = true;
+                        total_nodes += nodes;
+                    });
+            }
+            double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "[Benchmark] Tiered TT (" << threads << " threads, local " << local_bytes / 1024 << " KB): "
+                      << "time to depth " << depth << " " << s * 1000 << " ms, "
+                      << total_nodes / s / 1e6 << " Mnps, hashfull " << shared.hashfull() << "\n";
+            EXPECT_GT(total_nodes.load(), 0u);
+        }
+    }
+}
+
+TEST_F(TestHashTable, TieredTableRouting) {
+    hash_table shared;
+    shared.resize(1);
+    tiered_table tt(shared, 64 * 1024, 2);
+    Move m;
+    m.set(3, 11, MoveType::QUIET);
+    hash_data e;
+
+    tt.save(0xABCDEF01ULL, 2, bound_low, m, 5, 0, false); // shallow: local only
+    EXPECT_TRUE(tt.fetch(0xABCDEF01ULL, e));
+    EXPECT_FALSE(shared.fetch(0xABCDEF01ULL, e));
+
+    tt.save(0x12345678ULL, 3, bound_low, m, 6, 0, false); // deep: shared
+    EXPECT_TRUE(shared.fetch(0x12345678ULL, e));
+    EXPECT_EQ(e.move, m);
+
+    tt.clear();
+    EXPECT_FALSE(tt.fetch(0xABCDEF01ULL, e));
+    EXPECT_TRUE(tt.fetch(0x12345678ULL, e));
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include "input.h"
+
+namespace {
+    // An istream source that blocks like a GUI pipe until text is written
+    class PipeBuf : public std::streambuf {
+    public:
+        void write(const std::string &s) {
+            std::lock_guard<std::mutex> lock(mtx_);
+            pending_.insert(pending_.end(), s.begin(), s.end());
+            cv_.notify_one();
+        }
+        void close() {
+            std::lock_guard<std::mutex> lock(mtx_);
+            closed_ = true;
+            cv_.notify_one();
+        }
+
+    protected:
+        int_type underflow() override {
+            std::unique_lock<std::mutex> lock(mtx_);
+            cv_.wait(lock, [&] { return !pending_.empty() || closed_; });
+            if (pending_.empty())
+                return traits_type::eof();
+            buf_.assign(pending_.begin(), pending_.end());
+            pending_.clear();
+            setg(buf_.data(), buf_.data(), buf_.data() + buf_.size());
+            return traits_type::to_int_type(buf_[0]);
+        }
+
+    private:
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        std::deque<char> pending_;
+        std::string buf_;
+        bool closed_ = false;
+    };
+
+    using Clock = std::chrono::steady_clock;
+}
+
+class TestInput : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() { }
+    static void TearDownTestSuite() { }
+};
+
+TEST_F(TestInput, Command) {
+    EXPECT_EQ(Input::command("  PonderHit\r"), "ponderhit");
+    EXPECT_EQ(Input::command("go wtime 100"), "go");
+    EXPECT_EQ(Input::command(""), "");
+}
+
+TEST_F(TestInput, QueuesInOrderUntilQuit) {
+    PipeBuf buf;
+    std::istream in(&buf);
+    Input::Reader reader(in, nullptr);
+    buf.write("uci\r\nposition startpos\ngo depth 5\nquit\nnever read\n");
+
+    std::string line;
+    for (const char *expected : {"uci", "position startpos", "go depth 5", "quit"}) {
+        ASSERT_TRUE(reader.next(line));
+        EXPECT_EQ(line, expected);
+    }
+    EXPECT_FALSE(reader.next(line));
+    EXPECT_FALSE(reader.poll(line));
+}
+
+// stop and ponderhit get through while the dispatcher is stuck in a slow command
+TEST_F(TestInput, UrgentWhileBusy) {
+    PipeBuf buf;
+    std::istream in(&buf);
+    std::atomic<int> stops(0), ponderhits(0);
+    std::atomic<Clock::rep> handled(0);
+    Input::Reader reader(in, [&](const std::string &line) {
+        const std::string cmd = Input::command(line);
+        if (cmd == "stop")
+            ++stops;
+        else if (cmd == "ponderhit")
+            ++ponderhits;
+        else
+            return false;
+        handled = Clock::now().time_since_epoch().count();
+        return true;
+    });
+
+    std::string line;
+    buf.write("setoption name Hash value 4096\n");
+    ASSERT_TRUE(reader.next(line));
+    EXPECT_FALSE(reader.idle());
+
+    const auto sent = Clock::now();
+    buf.write("ponderhit\nstop\nisready\n");
+    while (stops == 0)
+        std::this_thread::yield();
+    const double us = std::chrono::duration<double, std::micro>(Clock::duration(handled.load()) - sent.time_since_epoch()).count();
+    EXPECT_EQ(ponderhits.load(), 1);
+    EXPECT_LT(us, 50000.0);
+    std::cout << "[Benchmark] stop handled " << us << " us after it was sent, dispatcher busy\n";
+
+    EXPECT_FALSE(reader.idle());
+    ASSERT_TRUE(reader.next(line)); // the dispatcher gets only what is left
+    EXPECT_EQ(line, "isready");
+    EXPECT_FALSE(reader.poll(line));
+
+    buf.close();
+    EXPECT_FALSE(reader.next(line));
+}
@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <random>
 #include "magics.h"
 #include "bitboards.h"
 
@@ -47,31 +48,225 @@ TEST_F(TestMagicBitboards, RookBlocked) {
         << "Rook moves with blockers are incorrect.";
 }
 
-// Benchmarking move generation
+// Every occupancy subset of every square against the ray generator, on each backend
+TEST_F(TestMagicBitboards, BackendsMatchGenAttacks) {
+    for (auto backend : {Magics::Backend::MAGIC, Magics::Backend::PEXT}) {
+        if (!Magics::set_backend(backend))
+            continue;
+        for (SquareType_t s = Square::A1; s <= Square::H8; ++s) {
+            uint64_t mask = Bitboards::bishop_masks[s];
+            uint64_t b = 0ULL;
+            do {
+                EXPECT_EQ(Magics::attacks<Piece::BISHOP>(b, s), Magics::gen_attacks<Piece::BISHOP>(b, s));
+                b = (b - mask) & mask;
+            } while (b);
+
+            mask = Bitboards::rook_masks[s];
+            b = 0ULL;
+            do {
+                EXPECT_EQ(Magics::attacks<Piece::ROOK>(b, s), Magics::gen_attacks<Piece::ROOK>(b, s));
+                b = (b - mask) & mask;
+            } while (b);
+        }
+    }
+    Magics::set_backend(Magics::fast_pext() ? Magics::Backend::PEXT : Magics::Backend::MAGIC);
+}
+
+// Queen and x-ray lookups against the ray generator on random occupancies, on each backend
+TEST_F(TestMagicBitboards, QueenAndXrayMatchGenAttacks) {
+    std::mt19937_64 rng(20240615);
+    for (auto backend : {Magics::Backend::MAGIC, Magics::Backend::PEXT}) {
+        if (!Magics::set_backend(backend))
+            continue;
+        for (int i = 0; i < 500; ++i) {
+            uint64_t occ = rng() & rng();
+            uint64_t blockers = occ & rng();
+            for (SquareType_t s = Square::A1; s <= Square::H8; ++s) {
+                uint64_t b = Magics::gen_attacks<Piece::BISHOP>(occ, s);
+                uint64_t r = Magics::gen_attacks<Piece::ROOK>(occ, s);
+                uint64_t bx = b ^ Magics::gen_attacks<Piece::BISHOP>(occ ^ (blockers & b), s);
+                uint64_t rx = r ^ Magics::gen_attacks<Piece::ROOK>(occ ^ (blockers & r), s);
+                EXPECT_EQ(Magics::attacks<Piece::QUEEN>(occ, s), b | r);
+                EXPECT_EQ(Magics::xray_attacks<Piece::BISHOP>(occ, blockers, s), bx);
+                EXPECT_EQ(Magics::xray_attacks<Piece::ROOK>(occ, blockers, s), rx);
+                EXPECT_EQ(Magics::xray_attacks<Piece::QUEEN>(occ, blockers, s), bx | rx);
+            }
+        }
+    }
+    Magics::set_backend(Magics::fast_pext() ? Magics::Backend::PEXT : Magics::Backend::MAGIC);
+}
+
+// Rook on a1 behind a blocker on a3: the x-ray continues to a4..a8
+TEST_F(TestMagicBitboards, RookXray) {
+    uint64_t occ = Bitboards::square_masks[Square::A3] | Bitboards::square_masks[Square::C1];
+    uint64_t blockers = Bitboards::square_masks[Square::A3];
+    uint64_t expected = Bitboards::col_masks[0] & ~0xFFFFFFULL;
+    EXPECT_EQ(Magics::xray_attacks<Piece::ROOK>(occ, blockers, Square::A1), expected);
+}
+
+// Benchmarking move generation (magic and pext backends side by side)
 TEST_F(TestMagicBitboards, BishopMoveSpeed) {
-    uint64_t total_time         = 0;
     int iterations              = 1e6;
     uint64_t no_blockers        = 0ULL;
 
-    clock_t start = clock();
-    for (int i = 0; i < iterations; i++) {
-        Magics::attacks<Piece::BISHOP>(no_blockers, Square::D4);
+    for (auto backend : {Magics::Backend::MAGIC, Magics::Backend::PEXT}) {
+        const char* name = (backend == Magics::Backend::PEXT ? "pext" : "magic");
+        if (!Magics::set_backend(backend)) {
+            std::cout << "[Benchmark] Bishop MoveGen (" << name << "): not supported on this cpu\n";
+            continue;
+        }
+        clock_t start = clock();
+        for (int i = 0; i < iterations; i++) {
+            Magics::attacks<Piece::BISHOP>(no_blockers, Square::D4);
+        }
+        clock_t end = clock();
+        uint64_t total_time = (end - start) * 1000 / CLOCKS_PER_SEC;
+        std::cout << "[Benchmark] Bishop MoveGen (" << name << "): " << total_time << " ms for " << iterations << " iterations\n";
     }
-    clock_t end = clock();
-    total_time = (end - start) * 1000 / CLOCKS_PER_SEC;
-    std::cout << "[Benchmark] Bishop MoveGen: " << total_time << " ms for " << iterations << " iterations\n";
+    Magics::set_backend(Magics::fast_pext() ? Magics::Backend::PEXT : Magics::Backend::MAGIC);
 }
 
 TEST_F(TestMagicBitboards, RookMoveSpeed) {
-    uint64_t total_time         = 0;
     int iterations              = 1e6;
     uint64_t no_blockers        = 0ULL;
 
-    clock_t start = clock();
-    for (int i = 0; i < iterations; i++) {
-        Magics::attacks<Piece::ROOK>(no_blockers, Square::D4);
+    for (auto backend : {Magics::Backend::MAGIC, Magics::Backend::PEXT}) {
+        const char* name = (backend == Magics::Backend::PEXT ? "pext" : "magic");
+        if (!Magics::set_backend(backend)) {
+            std::cout << "[Benchmark] Rook MoveGen (" << name << "): not supported on this cpu\n";
+            continue;
+        }
+        clock_t start = clock();
+        for (int i = 0; i < iterations; i++) {
+            Magics::attacks<Piece::ROOK>(no_blockers, Square::D4);
+        }
+        clock_t end = clock();
+        uint64_t total_time = (end - start) * 1000 / CLOCKS_PER_SEC;
+        std::cout << "[Benchmark] Rook MoveGen (" << name << "): " << total_time << " ms for " << iterations << " iterations\n";
     }
-    clock_t end = clock();
-    total_time = (end - start) * 1000 / CLOCKS_PER_SEC;
-    std::cout << "[Benchmark] Rook MoveGen: " << total_time << " ms for " << iterations << " iterations\n";
-}
\ No newline at end of file
+    Magics::set_backend(Magics::fast_pext() ? Magics::Backend::PEXT : Magics::Backend::MAGIC);
+}
+
+// Table footprint and cache residency under random (roughly 16 piece) occupancies
+TEST_F(TestMagicBitboards, TableFootprint) {
+    const size_t samples = 4096;
+    const size_t l1_bytes = 32 * 1024;
+    const size_t l2_bytes = 1024 * 1024;
+    std::mt19937_64 rng(20240607);
+    std::vector<uint64_t> occs(samples);
+    for (auto &o : occs)
+        o = rng() & rng();
+
+    for (auto backend : {Magics::Backend::MAGIC, Magics::Backend::PEXT}) {
+        const char* name = (backend == Magics::Backend::PEXT ? "pext" : "magic");
+        if (!Magics::set_backend(backend))
+            continue;
+
+        size_t table_kb = Magics::table_bytes(backend) / 1024;
+        size_t lines = Magics::lines_touched(backend, occs.data(), occs.size());
+        size_t working_set = lines * 64;
+
+        uint64_t sink = 0ULL;
+        clock_t start = clock();
+        for (int rep = 0; rep < 8; ++rep)
+            for (auto &o : occs)
+                for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+                    sink ^= Magics::attacks<Piece::ROOK>(o, s) ^ Magics::attacks<Piece::BISHOP>(o, s);
+        clock_t end = clock();
+        EXPECT_NE(sink, 1ULL); // keep the lookups alive
+        double ns = double(end - start) * 1e9 / CLOCKS_PER_SEC / (8.0 * samples * 128);
+
+        std::cout << "[Benchmark] Slider tables (" << name << "): " << table_kb << " KB, "
+                  << lines << " lines touched (" << working_set / 1024 << " KB, "
+                  << 100 * std::min(working_set, l1_bytes) / working_set << "% fits L1, "
+                  << 100 * std::min(working_set, l2_bytes) / working_set << "% fits L2), "
+                  << ns << " ns/lookup\n";
+    }
+    Magics::set_backend(Magics::fast_pext() ? Magics::Backend::PEXT : Magics::Backend::MAGIC);
+}
+
+namespace {
+    template <PieceType_t p>
+    uint64_t attacks_loop(uint64_t occ, uint64_t pieces) {
+        uint64_t a = 0ULL;
+        for (; pieces; pieces &= pieces - 1) {
+            SquareType_t s = SquareType_t(__builtin_ctzll(pieces));
+            if (p == Piece::BISHOP || p == Piece::QUEEN)
+                a |= Magics::attacks<Piece::BISHOP>(occ, s);
+            if (p == Piece::ROOK || p == Piece::QUEEN)
+                a |= Magics::attacks<Piece::ROOK>(occ, s);
+        }
+        return a;
+    }
+}
+
+// Set-wise fill against the per-square loop, scalar and avx2
+TEST_F(TestMagicBitboards, AttacksAllMatchesLoop) {
+    std::mt19937_64 rng(20240611);
+    for (bool avx2 : {false, true}) {
+        if (!Magics::set_avx2(avx2))
+            continue;
+        for (int i = 0; i < 20000; ++i) {
+            uint64_t occ = rng() & rng();
+            uint64_t pieces = occ & rng() & rng();
+            EXPECT_EQ(Magics::attacks_all<Piece::BISHOP>(occ, pieces), attacks_loop<Piece::BISHOP>(occ, pieces));
+            EXPECT_EQ(Magics::attacks_all<Piece::ROOK>(occ, pieces), attacks_loop<Piece::ROOK>(occ, pieces));
+            EXPECT_EQ(Magics::attacks_all<Piece::QUEEN>(occ, pieces), attacks_loop<Piece::QUEEN>(occ, pieces));
+        }
+        EXPECT_EQ(Magics::attacks_all<Piece::ROOK>(0ULL, 0ULL), 0ULL);
+    }
+    Magics::set_avx2(Magics::has_avx2());
+}
+
+TEST_F(TestMagicBitboards, AttacksAllSpeed) {
+    const size_t samples = 4096;
+    std::mt19937_64 rng(20240612);
+    std::vector<std::pair<uint64_t, uint64_t>> sets(samples);
+    for (auto &[occ, pieces] : sets) {
+        occ = rng() & rng();
+        pieces = occ & rng() & rng() & rng(); // roughly 2 sliders
+    }
+
+    auto run = [&](const char *name, auto fn) {
+        uint64_t sink = 0ULL;
+        clock_t start = clock();
+        for (int rep = 0; rep < 64; ++rep)
+            for (auto &[occ, pieces] : sets)
+                sink ^= fn(occ, pieces);
+        clock_t end = clock();
+        EXPECT_NE(sink, 1ULL);
+        double ns = double(end - start) * 1e9 / CLOCKS_PER_SEC / (64.0 * samples);
+        std::cout << "[Benchmark] Queen-set attacks (" << name << "): " << ns << " ns/set\n";
+    };
+
+    run("per-square loop", [](uint64_t o, uint64_t p) { return attacks_loop<Piece::QUEEN>(o, p); });
+    Magics::set_avx2(false);
+    run("kogge-stone scalar", [](uint64_t o, uint64_t p) { return Magics::attacks_all<Piece::QUEEN>(o, p); });
+    if (Magics::set_avx2(true))
+        run("kogge-stone avx2", [](uint64_t o, uint64_t p) { return Magics::attacks_all<Piece::QUEEN>(o, p); });
+    Magics::set_avx2(Magics::has_avx2());
+}
+
+// Lookups from the huge-page copy match the compile-time tables
+TEST_F(TestMagicBitboards, HugePageTables) {
+    bool huge = Magics::set_huge_pages(true);
+    std::cout << "[Benchmark] Slider tables: " << Magics::page_info() << "\n";
+    if (huge) {
+        EXPECT_NE(Magics::page_info(), "read-only data");
+    }
+
+    std::mt19937_64 rng(20240618);
+    for (auto backend : {Magics::Backend::MAGIC, Magics::Backend::PEXT}) {
+        if (!Magics::set_backend(backend))
+            continue;
+        for (int i = 0; i < 500; ++i) {
+            uint64_t occ = rng() & rng();
+            for (SquareType_t s = Square::A1; s <= Square::H8; ++s)
+                EXPECT_EQ(Magics::attacks<Piece::QUEEN>(occ, s),
+                          Magics::gen_attacks<Piece::BISHOP>(occ, s) | Magics::gen_attacks<Piece::ROOK>(occ, s));
+        }
+    }
+    Magics::set_backend(Magics::fast_pext() ? Magics::Backend::PEXT : Magics::Backend::MAGIC);
+    EXPECT_TRUE(Magics::set_huge_pages(false));
+    EXPECT_EQ(Magics::page_info(), "read-only data");
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include "notation.h"
+
+class TestNotation : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() { }
+    static void TearDownTestSuite() { }
+};
+
+TEST_F(TestNotation, ParseMove) {
+    Notation::UciMove m;
+    ASSERT_TRUE(Notation::parse_move("e2e4", m));
+    EXPECT_EQ(m.from, Square::E2);
+    EXPECT_EQ(m.to, Square::E4);
+    EXPECT_EQ(m.promote, Piece::NONE);
+
+    ASSERT_TRUE(Notation::parse_move("a7b8N", m));
+    EXPECT_EQ(m.from, Square::A7);
+    EXPECT_EQ(m.to, Square::B8);
+    EXPECT_EQ(m.promote, Piece::KNIGHT);
+    EXPECT_EQ(Notation::to_string(m), "a7b8n");
+
+    Notation::UciMove castle;
+    ASSERT_TRUE(Notation::parse_move("e8c8", castle));
+    EXPECT_EQ(Notation::to_string(castle), "e8c8");
+
+    for (const char *bad : {"", "e2", "e2e", "e2e9", "i2e4", "e2e2", "e7e8k", "e2e4e5", "0000"})
+        EXPECT_FALSE(Notation::parse_move(bad, m)) << bad;
+
+    for (int from = 0; from < 64; ++from)
+        for (int to = 0; to < 64; ++to) {
+            if (from == to)
+                continue;
+            Notation::UciMove a{uint8(from), uint8(to), Piece::QUEEN}, b;
+            ASSERT_TRUE(Notation::parse_move(Notation::to_string(a), b));
+            EXPECT_EQ(a, b);
+        }
+}
+
+TEST_F(TestNotation, ParsePosition) {
+    Notation::PositionCommand cmd;
+    ASSERT_TRUE(Notation::parse_position(" startpos", cmd));
+    EXPECT_EQ(cmd.start, "startpos");
+    EXPECT_TRUE(cmd.moves.empty());
+
+    ASSERT_TRUE(Notation::parse_position("startpos moves e2e4 e7e5", cmd));
+    EXPECT_EQ(cmd.moves, (std::vector<std::string>{"e2e4", "e7e5"}));
+
+    ASSERT_TRUE(Notation::parse_position("fen 8/8/8/8/8/8/8/K6k w - - 0 1 moves a1a2", cmd));
+    EXPECT_EQ(cmd.start, "8/8/8/8/8/8/8/K6k w - - 0 1");
+    EXPECT_EQ(cmd.moves, (std::vector<std::string>{"a1a2"}));
+
+    ASSERT_TRUE(Notation::parse_position("fen 8/8/8/8/8/8/8/K6k w - - 0 1", cmd));
+    EXPECT_EQ(cmd.start, "8/8/8/8/8/8/8/K6k w - - 0 1");
+    EXPECT_TRUE(cmd.moves.empty());
+
+    EXPECT_FALSE(Notation::parse_position("", cmd));
+    EXPECT_FALSE(Notation::parse_position("fen moves e2e4", cmd));
+    EXPECT_FALSE(Notation::parse_position("moves e2e4", cmd));
+}
+
+TEST_F(TestNotation, ResumeFrom) {
+    Notation::PositionCommand none, a, b, c, d;
+    Notation::parse_position("startpos moves e2e4 e7e5", a);
+    Notation::parse_position("startpos moves e2e4 e7e5 g1f3 b8c6", b);
+    Notation::parse_position("startpos moves d2d4 e7e5 g1f3 b8c6", c);
+    Notation::parse_position("fen 8/8/8/8/8/8/8/K6k w - - 0 1 moves e2e4 e7e5 g1f3", d);
+
+    EXPECT_EQ(Notation::resume_from(none, a), -1); // nothing loaded yet
+    EXPECT_EQ(Notation::resume_from(a, b), 2);
+    EXPECT_EQ(Notation::resume_from(b, b), 4); // resent as is
+    EXPECT_EQ(Notation::resume_from(b, a), -1); // taken back
+    EXPECT_EQ(Notation::resume_from(a, c), -1); // other game
+    EXPECT_EQ(Notation::resume_from(a, d), -1); // other start
+}
+
+// An analysis server resending a 300 ply game one move at a time: only the
+// last move of each command is left to play.
+TEST_F(TestNotation, ParseFen) {
+    Notation::Fen f;
+    ASSERT_TRUE(Notation::parse_fen("r3k2r/8/8/8/4Pp2/8/8/R3K2R b Kq e3 3 42", f));
+    EXPECT_EQ(f.piece[0], Piece::ROOK);
+    EXPECT_EQ(f.color[0], Color::WHITE);
+    EXPECT_EQ(f.piece[60], Piece::KING);
+    EXPECT_EQ(f.color[60], Color::BLACK);
+    EXPECT_EQ(f.piece[28], Piece::PAWN);
+    EXPECT_EQ(f.piece[27], Piece::NONE);
+    EXPECT_EQ(f.side, Color::BLACK);
+    EXPECT_EQ(f.castling[Color::WHITE], 1);
+    EXPECT_EQ(f.castling[Color::BLACK], 2);
+    EXPECT_EQ(f.ep_file, 4);
+    EXPECT_EQ(f.halfmove, 3);
+    EXPECT_EQ(f.fullmove, 42);
+
+    ASSERT_TRUE(Notation::parse_fen("8/8/8/8/8/8/8/K6k w - -", f)); // EPD, no clocks
+    EXPECT_EQ(f.ep_file, -1);
+    EXPECT_EQ(f.fullmove, 1);
+
+    for (const char *bad : {"", "8/8/8/8/8/8/8/8 w - - 0 1", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1",
+                            "rnbqkbnr/ppppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+                            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1",
+                            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNX w KQkq - 0 1",
+                            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQxq - 0 1",
+                            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e9 0 1",
+                            "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - x 1"})
+        EXPECT_FALSE(Notation::parse_fen(bad, f)) << bad;
+}
+
+TEST_F(TestNotation, FenKey) {
+    Notation::Fen a, b, c, d;
+    ASSERT_TRUE(Notation::parse_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", a));
+    ASSERT_TRUE(Notation::parse_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 0 1", b));
+    ASSERT_TRUE(Notation::parse_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w Kkq - 0 1", c));
+    ASSERT_TRUE(Notation::parse_fen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 7 30", d));
+    EXPECT_NE(Notation::key(a), Notation::key(b));
+    EXPECT_NE(Notation::key(a), Notation::key(c));
+    EXPECT_EQ(Notation::key(a), Notation::key(d)); // the clocks are not part of the key
+}
+
+TEST_F(TestNotation, GrowingGame) {
+    std::string args = "startpos moves";
+    Notation::PositionCommand loaded, next;
+    size_t replayed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int ply = 0; ply < 300; ++ply) {
+        args += " " + Notation::to_string({uint8(ply % 64), uint8((ply + 9) % 64), Piece::NONE});
+        ASSERT_TRUE(Notation::parse_position(args, next));
+        int first = Notation::resume_from(loaded, next);
+        replayed += next.moves.size() - size_t(std::max(first, 0));
+        for (size_t i = size_t(std::max(first, 0)); i < next.moves.size(); ++i) {
+            Notation::UciMove m;
+            ASSERT_TRUE(Notation::parse_move(next.moves[i], m));
+        }
+        std::swap(loaded, next);
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_EQ(replayed, 300u);
+    std::cout << "[Benchmark] 300 growing position commands: " << us / 300 << " us/command, " << replayed
+              << " moves played instead of " << 300 * 301 / 2 << "\n";
+}
@@ -0,0 +1,276 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <sstream>
+#include <sched.h>
+#include "search.h"
+#include "synthetic_tree.h"
+
+namespace {
+    struct SyntheticPosition {
+        uint64_t key = 0;
+    };
+
+    const SyntheticTree tree;
+
+    auto iterate = [](Search::ThreadData<SyntheticPosition> &td, int depth, const std::atomic_bool &stop) {
+        uint64_t nodes = 0;
+        auto r = tree.root(td.tt, td.pos.key, depth, int(td.id), nodes, stop);
+        td.nodes += nodes;
+        return r;
+    };
+
+    // The synthetic tree search with the SMP hooks an engine search would have:
+    // busy marks on non-PV nodes and deferred siblings in the move loop.
+    int smp_search(Search::ThreadData<SyntheticPosition> &td, uint64_t key, int ply, int depth, bool pv, int rotate,
+                   uint64_t &nodes, const std::atomic_bool &stop) {
+        ++nodes;
+        hash_data e;
+        if (td.tt.fetch(key, e) && e.depth >= depth)
+            return e.score;
+        if (depth == 0 || stop)
+            return int(key & 0xFF);
+
+        Search::BusyMark<SyntheticPosition> busy(td, key, depth, pv);
+        int best = -1;
+        int deferred[SyntheticTree::branching], num_deferred = 0;
+        for (int i = 0; i < SyntheticTree::branching; ++i) {
+            uint64_t child = tree.child(key, ply, (i + rotate) % SyntheticTree::branching);
+            if (Search::defer_move(td, child, i, depth)) {
+                deferred[num_deferred++] = i;
+                continue;
+            }
+            best = std::max(best, 255 - smp_search(td, child, ply + 1, depth - 1, pv && i == 0, rotate, nodes, stop));
+        }
+        for (int n = 0; n < num_deferred; ++n) {
+            uint64_t child = tree.child(key, ply, (deferred[n] + rotate) % SyntheticTree::branching);
+            best = std::max(best, 255 - smp_search(td, child, ply + 1, depth - 1, false, rotate, nodes, stop));
+        }
+        if (stop)
+            return best;
+        Move m;
+        td.tt.save(key, uint8_t(depth), bound_exact, m, int16_t(best), 0, false);
+        return best;
+    }
+
+    // ABDADA threads share one move order, deferral spreads them over the tree;
+    // lazy threads each rotate their move order.
+    auto smp_iterate = [](Search::ThreadData<SyntheticPosition> &td, int depth, const std::atomic_bool &stop) {
+        const int rotate = (td.mode == Search::SmpMode::LAZY ? int(td.id) : 0);
+        std::pair<Move, int> best = {Move(), -1};
+        uint64_t nodes = 1;
+        for (int i = 0; i < SyntheticTree::branching; ++i) {
+            int c = (i + rotate) % SyntheticTree::branching;
+            int score = 255 - smp_search(td, tree.child(td.pos.key, 0, c), 1, depth - 1, i == 0, rotate, nodes, stop);
+            if (score > best.second) {
+                best.first.set(uint8_t(c), 0, MoveType::QUIET);
+                best.second = score;
+            }
+        }
+        td.nodes += nodes;
+        return best;
+    };
+}
+
+class TestSearch : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() { }
+    static void TearDownTestSuite() { }
+};
+
+TEST_F(TestSearch, DepthSkew) {
+    for (int d = 1; d < 20; ++d)
+        EXPECT_FALSE(Search::skip_depth(0, d));
+    EXPECT_NE(Search::skip_depth(1, 4), Search::skip_depth(2, 4)); // helpers 1 and 2 alternate
+    for (int d = 1; d < 20; ++d) {
+        int searching = 0;
+        for (unsigned int id = 1; id <= 20; ++id)
+            searching += !Search::skip_depth(id, d);
+        EXPECT_GE(searching, 8);
+    }
+}
+
+// The main thread always completes the full depth, and as no thread searches
+// deeper its score is the exact minimax value. (A helper that won the vote at a
+// lower depth may have used deeper table entries.)
+TEST_F(TestSearch, LazySmpMatchesSingleThread) {
+    hash_table table;
+    table.resize(4);
+    Search::SearchPool<SyntheticPosition> pool;
+
+    for (unsigned int threads : {1u, 4u}) {
+        pool.init(threads, table);
+        Search::Result r = pool.search(SyntheticPosition{0x5555ULL}, 6, iterate);
+        EXPECT_GE(r.depth, 5);
+
+        hash_table fresh;
+        fresh.resize(4);
+        std::atomic_bool stop(false);
+        uint64_t nodes = 0;
+        auto [move, score] = tree.root(fresh, 0x5555ULL, 6, 0, nodes, stop);
+        EXPECT_EQ(pool[0].completed_depth, 6);
+        EXPECT_EQ(pool[0].best_score, score) << threads << " threads";
+        if (threads == 1) {
+            EXPECT_EQ(r.move, move);
+        }
+        if (r.depth == 6) {
+            EXPECT_EQ(r.score, score);
+        }
+        EXPECT_GT(r.nodes, 0u);
+    }
+}
+
+// Driver plumbing only: the thread pool, depth skew, voting and the shared
+// table over the synthetic tree. There is no chess search in this tree yet, so
+// this is not the engine's Lazy SMP scaling benchmark; that needs Search::start
+// and real positions.
+TEST_F(TestSearch, LazySmpDriverScaling) {
+    hash_table table;
+    table.resize(16);
+    Search::SearchPool<SyntheticPosition> pool;
+    const uint64_t suite[] = {0x1ULL, 0xBEEFULL, 0x123456789ULL, 0xFEEDFACEULL};
+    const int depth = 7;
+
+    for (unsigned int threads : {1u, 2u, 4u, 8u, 16u, 32u}) {
+        pool.init(threads, table);
+        double ms = 0.0;
+        uint64_t nodes = 0;
+        for (uint64_t key : suite) {
+            table.clear();
+            auto start = std::chrono::steady_clock::now();
+            Search::Result r = pool.search(SyntheticPosition{key}, depth, iterate);
+            ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            nodes += r.nodes;
+        }
+        std::cout << "[Benchmark] Lazy SMP driver, synthetic tree (" << threads << " threads): time to depth " << depth << " "
+                  << ms / 4 << " ms/position, " << nodes / (ms / 1000) / 1e6 << " Mnps\n";
+    }
+}
+
+TEST_F(TestSearch, AbdadaMatchesSingleThread) {
+    hash_table table;
+    table.resize(4);
+    Search::SearchPool<SyntheticPosition> pool;
+    pool.set_mode(Search::SmpMode::ABDADA);
+
+    for (unsigned int threads : {1u, 4u}) {
+        pool.init(threads, table);
+        table.clear();
+        Search::Result r = pool.search(SyntheticPosition{0x5555ULL}, 6, smp_iterate);
+        EXPECT_GE(r.depth, 5);
+
+        hash_table fresh;
+        fresh.resize(4);
+        std::atomic_bool stop(false);
+        uint64_t nodes = 0;
+        auto [move, score] = tree.root(fresh, 0x5555ULL, 6, 0, nodes, stop);
+        EXPECT_EQ(pool[0].completed_depth, 6);
+        EXPECT_EQ(pool[0].best_score, score) << threads << " threads";
+        if (threads == 1) {
+            EXPECT_EQ(r.deferred, 0u);
+        }
+    }
+}
+
+// The table clears on the search threads of the pool it was last given to
+TEST_F(TestSearch, PoolClearsItsTable) {
+    hash_table table(16);
+    EXPECT_EQ(table.threads(), nullptr);
+    {
+        Search::SearchPool<SyntheticPosition> pool;
+        pool.init(3, table);
+        ASSERT_NE(table.threads(), nullptr);
+        EXPECT_EQ(table.threads()->size(), 3u);
+        Move m;
+        table.save(0x1234ULL, 5, bound_exact, m, 1, 0, false);
+        table.clear();
+        hash_data e;
+        EXPECT_FALSE(table.fetch(0x1234ULL, e));
+    }
+    EXPECT_EQ(table.threads(), nullptr);
+}
+
+TEST_F(TestSearch, BusyMarks) {
+    hash_table table;
+    table.resize(1);
+    bool overlap = true;
+    EXPECT_FALSE(table.is_searching(0x1234ULL));
+    EXPECT_TRUE(table.mark_searching(0x1234ULL, overlap));
+    EXPECT_FALSE(overlap);
+    EXPECT_TRUE(table.is_searching(0x1234ULL));
+
+    EXPECT_FALSE(table.mark_searching(0x1234ULL, overlap)); // a second thread entering
+    EXPECT_TRUE(overlap);
+    EXPECT_FALSE(table.mark_searching(0x1234ULL + busy_slots, overlap)); // same slot, other position
+    EXPECT_FALSE(overlap);
+    EXPECT_FALSE(table.is_searching(0x1234ULL + busy_slots));
+
+    table.clear_searching(0x1234ULL);
+    EXPECT_FALSE(table.is_searching(0x1234ULL));
+}
+
+// Nodes to a fixed depth and the share of node entries that found another
+// thread inside the same position, plain shared-hash search against ABDADA.
+TEST_F(TestSearch, AbdadaOverlap) {
+    hash_table table;
+    table.resize(16);
+    Search::SearchPool<SyntheticPosition> pool;
+    pool.measure_overlap(true);
+    const uint64_t suite[] = {0x1ULL, 0xBEEFULL, 0x123456789ULL, 0xFEEDFACEULL};
+    const int depth = 7;
+
+    for (unsigned int threads : {1u, 4u, 16u}) {
+        pool.init(threads, table);
+        for (Search::SmpMode mode : {Search::SmpMode::LAZY, Search::SmpMode::ABDADA}) {
+            pool.set_mode(mode);
+            double ms = 0.0;
+            uint64_t nodes = 0, overlaps = 0, deferred = 0;
+            for (uint64_t key : suite) {
+                table.clear();
+                auto start = std::chrono::steady_clock::now();
+                Search::Result r = pool.search(SyntheticPosition{key}, depth, smp_iterate);
+                ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                nodes += r.nodes;
+                overlaps += r.overlaps;
+                deferred += r.deferred;
+            }
+            std::cout << "[Benchmark] " << (mode == Search::SmpMode::LAZY ? "Lazy SMP" : "ABDADA  ") << " (" << threads
+                      << " threads): " << nodes / 4 << " nodes/position, overlap " << 100.0 * double(overlaps) / double(nodes)
+                      << "%, " << deferred / 4 << " deferred, " << ms / 4 << " ms/position\n";
+        }
+    }
+}
+
+TEST_F(TestSearch, NumaPlacement) {
+    const auto &nodes = Numa::nodes();
+    ASSERT_FALSE(nodes.empty());
+    for (unsigned int t = 0; t < 2 * nodes.size(); ++t)
+        EXPECT_EQ(Numa::node_of(t), nodes[t % nodes.size()].id); // neighbours on different nodes
+    std::cout << "[Benchmark] topology: " << Numa::describe() << "\n";
+
+    std::atomic_bool ok(false);
+    std::atomic<int> cpu(-1);
+    WorkerThread w([&] {
+        ok = Numa::bind_thread(1);
+        cpu = sched_getcpu();
+    });
+    w.thread().join();
+    EXPECT_TRUE(ok);
+    EXPECT_EQ(cpu.load(), Numa::cpu_of(1));
+}
+
+// Per-thread speed with and without pinning, imbalances show up as outliers
+TEST_F(TestSearch, PerThreadNps) {
+    hash_table table;
+    table.resize(16);
+    Search::SearchPool<SyntheticPosition> pool;
+    pool.init(4, table);
+    for (bool bind : {false, true}) {
+        pool.set_binding(bind);
+        table.clear();
+        Search::Result r = pool.search(SyntheticPosition{0xBEEFULL}, 7, iterate);
+        EXPECT_GE(r.depth, 5);
+        std::ostringstream os;
+        pool.report_threads(os);
+        std::cout << "[Benchmark] threads " << (bind ? "bound" : "unbound") << ":\n" << os.str();
+    }
+}
@@ -0,0 +1,279 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <numeric>
+#include <set>
+#include <mutex>
+#include <vector>
+#include "threads.h"
+
+class TestThreads : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() { }
+    static void TearDownTestSuite() { }
+};
+
+namespace {
+    template <class Pool>
+    void wait_all(Pool &pool, unsigned int tasks) {
+        while (pool.get_processed() < tasks)
+            pool.wait_finished();
+    }
+
+    // Perft-style splitting: every task spawns fanout children until depth 0
+    template <class Pool>
+    void spawn(Pool &pool, int depth, int fanout, std::atomic<uint64_t> &leaves) {
+        if (depth == 0) {
+            leaves.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        for (int i = 0; i < fanout; ++i)
+            pool.enqueue([&pool, depth, fanout, &leaves] { spawn(pool, depth - 1, fanout, leaves); });
+    }
+
+    template <class Pool>
+    void check_groups() {
+        Pool pool(4);
+        TaskGroup a, b;
+        std::atomic<int> done_a(0), done_b(0);
+        std::atomic_bool release(false);
+        for (int i = 0; i < 100; ++i)
+            pool.enqueue(a, [&done_a] { ++done_a; });
+        pool.enqueue(b, [&done_b, &release] {
+            while (!release)
+                std::this_thread::yield();
+            ++done_b;
+        });
+        pool.wait(a); // returns while b is still blocked
+        EXPECT_EQ(done_a.load(), 100);
+        EXPECT_TRUE(a.finished());
+        EXPECT_FALSE(b.finished());
+        release = true;
+        pool.wait(pool.enqueue(b, [&done_b] { ++done_b; }));
+        EXPECT_EQ(done_b.load(), 2);
+
+        std::future<int> f = pool.submit([](int x, int y) { return x * y; }, 6, 7);
+        EXPECT_EQ(f.get(), 42);
+    }
+
+    // Workers that stay across a resize keep their threads
+    template <class Pool>
+    void check_resize() {
+        Pool pool(2);
+        auto thread_ids = [&pool](unsigned int tasks) {
+            std::mutex m;
+            std::set<std::thread::id> ids;
+            TaskGroup g;
+            for (unsigned int i = 0; i < tasks; ++i)
+                pool.enqueue(g, [&] {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    std::lock_guard<std::mutex> lock(m);
+                    ids.insert(std::this_thread::get_id());
+                });
+            pool.wait(g);
+            return ids;
+        };
+        std::set<std::thread::id> two = thread_ids(64);
+        pool.resize(6);
+        EXPECT_EQ(pool.num_workers(), 6u);
+        std::set<std::thread::id> six = thread_ids(256);
+        for (auto id : two)
+            EXPECT_EQ(six.count(id), 1u);
+        pool.resize(1);
+        EXPECT_EQ(pool.num_workers(), 1u);
+        EXPECT_EQ(thread_ids(8).size(), 1u);
+        pool.exit();
+        pool.resize(3); // restart after exit
+        EXPECT_EQ(thread_ids(64).size(), 3u);
+    }
+
+    template <class Pool>
+    double flat_tasks_per_sec(unsigned int threads, unsigned int tasks) {
+        Pool pool(threads);
+        std::atomic<uint64_t> sum(0);
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < tasks; ++i)
+            pool.enqueue([&sum](unsigned int v) { sum.fetch_add(v, std::memory_order_relaxed); }, i);
+        wait_all(pool, tasks);
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        EXPECT_EQ(sum.load(), uint64_t(tasks) * (tasks - 1) / 2);
+        return tasks / s;
+    }
+
+    template <class Pool>
+    double nested_tasks_per_sec(unsigned int threads, int depth, int fanout) {
+        Pool pool(threads);
+        std::atomic<uint64_t> leaves(0);
+        unsigned int tasks = 0, level = 1;
+        for (int d = 0; d <= depth; ++d, level *= fanout)
+            tasks += level;
+        auto start = std::chrono::steady_clock::now();
+        pool.enqueue([&pool, depth, fanout, &leaves] { spawn(pool, depth, fanout, leaves); });
+        wait_all(pool, tasks);
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        EXPECT_EQ(leaves.load(), uint64_t(tasks - (tasks - 1) / fanout));
+        return tasks / s;
+    }
+}
+
+TEST_F(TestThreads, TaskStorage) {
+    int calls = 0;
+    Task small([&calls] { ++calls; });
+    Task moved(std::move(small));
+    EXPECT_FALSE(small);
+    moved();
+    EXPECT_EQ(calls, 1);
+
+    // too big for the inline buffer, and a capture with a destructor
+    auto shared = std::make_shared<int>(0);
+    std::array<char, 100> big{};
+    Task large([shared, big] { *shared += int(big.size()); });
+    EXPECT_EQ(shared.use_count(), 2);
+    Task other;
+    other = std::move(large);
+    other();
+    EXPECT_EQ(*shared, 100);
+    other.reset();
+    EXPECT_EQ(shared.use_count(), 1);
+}
+
+TEST_F(TestThreads, WorkDequeOwnerAndThieves) {
+    WorkDeque<Task> deque;
+    const int total = 200000;
+    std::atomic<int> taken(0);
+    std::atomic<uint64_t> sum(0);
+    std::atomic_bool done(false);
+
+    std::vector<WorkerThread> thieves;
+    for (int i = 0; i < 3; ++i)
+        thieves.emplace_back([&] {
+            Task t;
+            while (!done || taken < total)
+                if (deque.steal(t)) {
+                    t();
+                    ++taken;
+                }
+        });
+
+    Task t;
+    for (int i = 0; i < total; ++i) {
+        while (!deque.push(Task([&sum, i] { sum += uint64_t(i); })))
+            if (deque.pop(t)) {
+                t();
+                ++taken;
+            }
+        if (i % 3 == 0 && deque.pop(t)) {
+            t();
+            ++taken;
+        }
+    }
+    while (deque.pop(t)) {
+        t();
+        ++taken;
+    }
+    done = true;
+    thieves.clear();
+    EXPECT_EQ(taken.load(), total);
+    EXPECT_EQ(sum.load(), uint64_t(total) * (total - 1) / 2);
+}
+
+TEST_F(TestThreads, WorkStealingPool) {
+    ThreadPool<WorkerThread, WorkStealing> pool;
+    for (int threads : {1, 4}) {
+        pool.init(threads);
+        EXPECT_EQ(pool.num_workers(), size_t(threads));
+
+        std::atomic<uint64_t> leaves(0);
+        pool.enqueue([&pool, &leaves] { spawn(pool, 4, 6, leaves); });
+        wait_all(pool, 1 + 6 + 36 + 216 + 1296);
+        EXPECT_EQ(leaves.load(), 1296u);
+
+        std::vector<int> out(10000, 0);
+        for (int i = 0; i < 10000; ++i)
+            pool.enqueue([&out](int j) { out[j] = j; }, i);
+        pool.wait_finished();
+        EXPECT_EQ(pool.get_processed(), 1555u + 10000u);
+        EXPECT_EQ(std::accumulate(out.begin(), out.end(), 0LL), 10000LL * 9999 / 2);
+
+        // more than a deque and the injection queue hold, pushed from a worker
+        std::atomic<int> count(0);
+        const unsigned int before = pool.get_processed();
+        pool.enqueue([&pool, &count] {
+            for (int i = 0; i < 20000; ++i)
+                pool.enqueue([&count] { ++count; });
+        });
+        wait_all(pool, before + 20001);
+        EXPECT_EQ(count.load(), 20000);
+    }
+    pool.exit();
+}
+
+TEST_F(TestThreads, TaskGroupsAndFutures) {
+    check_groups<ThreadPool<WorkerThread>>();
+    check_groups<ThreadPool<WorkerThread, WorkStealing>>();
+}
+
+TEST_F(TestThreads, ResizeKeepsWorkers) {
+    check_resize<ThreadPool<WorkerThread>>();
+    check_resize<ThreadPool<WorkerThread, WorkStealing>>();
+}
+
+// A parent task waiting on its children from inside the pool
+TEST_F(TestThreads, NestedWait) {
+    ThreadPool<WorkerThread, WorkStealing> pool(2);
+    std::atomic<int> leaves(0);
+    TaskGroup root;
+    pool.enqueue(root, [&pool, &leaves] {
+        for (int i = 0; i < 8; ++i) {
+            TaskGroup children;
+            for (int j = 0; j < 8; ++j)
+                pool.enqueue(children, [&leaves] { ++leaves; });
+            pool.wait(children);
+        }
+    });
+    pool.wait(root);
+    EXPECT_EQ(leaves.load(), 64);
+}
+
+// Thread count changes between games: resize and exit must return as soon as
+// the pool is idle, not after a timeout.
+TEST_F(TestThreads, ReconfigurationTime) {
+    ThreadPool<WorkerThread> pool(1);
+    double worst = 0.0, total = 0.0;
+    int n = 0;
+    for (unsigned int threads : {4u, 1u, 8u, 2u, 16u, 1u}) {
+        std::atomic<int> count(0);
+        for (int i = 0; i < 1000; ++i)
+            pool.enqueue([&count] { ++count; });
+        auto start = std::chrono::steady_clock::now();
+        pool.resize(threads);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        EXPECT_EQ(count.load(), 1000);
+        worst = std::max(worst, ms);
+        total += ms;
+        ++n;
+    }
+    auto start = std::chrono::steady_clock::now();
+    pool.exit();
+    double exit_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_LT(worst, 1000.0);
+    std::cout << "[Benchmark] pool resize: " << total / n << " ms average, " << worst << " ms worst, exit " << exit_ms << " ms\n";
+}
+
+// Tasks/sec for many tiny tasks submitted from outside the pool (batch EPD,
+// tuning) and for tasks spawning tasks (perft splitting).
+TEST_F(TestThreads, SchedulerThroughput) {
+    for (unsigned int threads : {1u, 2u, 4u, 8u, 16u, 32u, 64u}) {
+        double shared = flat_tasks_per_sec<ThreadPool<WorkerThread>>(threads, 200000);
+        double stealing = flat_tasks_per_sec<ThreadPool<WorkerThread, WorkStealing>>(threads, 200000);
+        std::cout << "[Benchmark] flat tasks (" << threads << " threads): shared queue " << shared / 1e6
+                  << " M/s, work stealing " << stealing / 1e6 << " M/s\n";
+    }
+    for (unsigned int threads : {1u, 2u, 4u, 8u, 16u, 32u, 64u}) {
+        double shared = nested_tasks_per_sec<ThreadPool<WorkerThread>>(threads, 6, 6);
+        double stealing = nested_tasks_per_sec<ThreadPool<WorkerThread, WorkStealing>>(threads, 6, 6);
+        std::cout << "[Benchmark] nested tasks (" << threads << " threads): shared queue " << shared / 1e6
+                  << " M/s, work stealing " << stealing / 1e6 << " M/s\n";
+    }
+}
@@ -0,0 +1,340 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+#include "search.h"
+#include "threads.h"
+#include "timeman.h"
+#include "synthetic_tree.h"
+
+class TestTimeman : public ::testing::Test {
+protected:
+    static void SetUpTestSuite() { }
+    static void TearDownTestSuite() { }
+};
+
+namespace {
+    struct TimeControl {
+        const char *name;
+        int base_ms;
+        int inc_ms;
+        int moves; // moves per control, 0 = sudden death
+    };
+
+    struct GameStats {
+        int losses = 0;
+        int moves = 0;
+        double used = 0.0, soft = 0.0; // engine time (without the lag) and its target
+        double min_clock = 1e18; // lowest clock left after a move, ms
+    };
+
+    limits clock_limits(int time, int inc, int movestogo) {
+        limits l;
+        std::memset(&l, 0, sizeof(l));
+        l.wtime = unsigned(std::max(time, 0));
+        l.winc = unsigned(inc);
+        l.movestogo = unsigned(movestogo);
+        return l;
+    }
+
+    // One move of a simulated search: iterations grow by a random branching factor,
+    // the best move settles with depth, now and then the score drops. Returns the
+    // time the engine used, stopping either at an iteration boundary or when the
+    // timer fires at the hard deadline (with up to 2 ms of timer latency).
+    double simulate_move(Time::Manager &tm, std::mt19937_64 &rng, double speed) {
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        double elapsed = 0.0, iteration = 0.05 * speed;
+        int score = 0;
+        Move best;
+        best.set(0, 0, MoveType::QUIET);
+        for (int depth = 1; depth < 128; ++depth) {
+            iteration *= 1.5 + u(rng);
+            if (tm.limited() && elapsed + iteration >= tm.hard_ms())
+                return tm.hard_ms() + 2.0 * u(rng);
+            elapsed += iteration;
+            if (u(rng) < 0.5 / depth + 0.05)
+                best.set(uint8_t(rng() % 64), 0, MoveType::QUIET);
+            score += int(u(rng) < 0.1 ? -40 - 80 * u(rng) : 20 * (u(rng) - 0.5));
+            if (tm.stop_after_iteration(elapsed, best, score))
+                return elapsed;
+        }
+        return elapsed;
+    }
+
+    // Plays games against the clock; the GUI charges each move the engine's time
+    // plus a random lag below the move overhead.
+    GameStats play(const TimeControl &tc, int games, uint64_t seed) {
+        std::mt19937_64 rng(seed);
+        std::uniform_real_distribution<double> u(0.0, 1.0);
+        GameStats st;
+        for (int g = 0; g < games; ++g) {
+            double clock = tc.base_ms;
+            const int length = 40 + int(rng() % 120);
+            const double speed = 0.2 + 5.0 * u(rng); // some positions are much slower to search
+            for (int move = 0; move < length; ++move) {
+                const int movestogo = tc.moves ? tc.moves - move % tc.moves : 0;
+                Time::Manager tm;
+                tm.init(clock_limits(int(clock), tc.inc_ms, movestogo), Color::WHITE, 2 * move);
+                const double used = simulate_move(tm, rng, speed);
+                clock -= used + Time::MOVE_OVERHEAD * 0.8 * u(rng);
+                st.used += used;
+                st.soft += tm.soft_ms();
+                ++st.moves;
+                st.min_clock = std::min(st.min_clock, clock);
+                if (clock < 0) {
+                    ++st.losses;
+                    break;
+                }
+                clock += tc.inc_ms;
+                if (tc.moves && movestogo == 1)
+                    clock += tc.base_ms;
+            }
+        }
+        return st;
+    }
+}
+
+TEST_F(TestTimeman, Allocation) {
+    Time::Manager tm;
+    limits l = clock_limits(60000, 0, 0);
+    tm.init(l, Color::WHITE, 0);
+    EXPECT_TRUE(tm.limited());
+    EXPECT_NEAR(tm.soft_ms(), (60000 - 52 * 30) / 50, 2);
+    EXPECT_GT(tm.hard_ms(), tm.soft_ms());
+    EXPECT_LE(tm.hard_ms(), 0.75 * 60000);
+
+    tm.init(l, Color::BLACK, 0); // black has no clock here: unlimited
+    EXPECT_FALSE(tm.limited());
+
+    l = clock_limits(1000, 0, 1); // last move before the control
+    tm.init(l, Color::WHITE, 60);
+    EXPECT_LE(tm.hard_ms(), 0.9 * (1000 - 30));
+    EXPECT_GT(tm.soft_ms(), 500);
+
+    l = clock_limits(10, 0, 0); // less than the overhead left
+    tm.init(l, Color::WHITE, 100);
+    EXPECT_GE(tm.soft_ms(), 1);
+    EXPECT_LT(tm.hard_ms(), 10);
+
+    std::memset(&l, 0, sizeof(l));
+    l.movetime = 500;
+    tm.init(l, Color::WHITE, 0);
+    EXPECT_EQ(tm.soft_ms(), 470);
+    EXPECT_EQ(tm.hard_ms(), 470);
+    Move m;
+    EXPECT_FALSE(tm.stop_after_iteration(400, m, 0));
+    EXPECT_TRUE(tm.stop_after_iteration(470, m, 0));
+}
+
+TEST_F(TestTimeman, StabilityAndScoreDrops) {
+    Time::Manager tm;
+    tm.init(clock_limits(60000, 0, 0), Color::WHITE, 0);
+    Move a, b;
+    a.set(12, 28, MoveType::QUIET);
+    b.set(6, 21, MoveType::QUIET);
+
+    for (int i = 0; i < 6; ++i)
+        tm.stop_after_iteration(1, a, 10);
+    const double settled = tm.scale();
+    tm.stop_after_iteration(1, b, 10);
+    const double changed = tm.scale();
+    tm.stop_after_iteration(1, b, -90);
+    const double dropped = tm.scale();
+    EXPECT_LT(settled, 1.0);
+    EXPECT_GT(changed, 1.0);
+    EXPECT_GT(dropped, 1.05 * (1.15 - 0.1)); // one stable iteration, then the drop on top
+
+    // a settled search gives up earlier than an unsettled one
+    EXPECT_TRUE(tm.soft_ms() * settled < tm.soft_ms() * changed);
+}
+
+// Replays thousands of games under a spread of time controls: no game may lose
+// on time, and on average a move should take about the soft limit.
+TEST_F(TestTimeman, SimulatedClocks) {
+    const TimeControl controls[] = {
+        {"1+0.01", 1000, 10, 0},
+        {"10+0.1", 10000, 100, 0},
+        {"60+0.6", 60000, 600, 0},
+        {"5 min", 300000, 0, 0},
+        {"40/60", 60000, 0, 40},
+        {"10/5", 5000, 0, 10},
+        {"2+1", 2000, 1000, 0},
+    };
+    uint64_t seed = 1;
+    for (const TimeControl &tc : controls) {
+        GameStats st = play(tc, 500, seed++);
+        const double ratio = st.used / st.soft;
+        EXPECT_EQ(st.losses, 0) << tc.name;
+        if (st.soft / st.moves > 10) { // a 1 ms target is below the iteration granularity
+            EXPECT_GT(ratio, 0.8) << tc.name;
+            EXPECT_LT(ratio, 1.2) << tc.name;
+        }
+        std::cout << "[Benchmark] " << tc.name << ": " << st.moves << " moves, " << st.losses << " losses on time, "
+                  << st.used / st.moves << " ms/move, used/target " << ratio << ", lowest clock " << st.min_clock << " ms\n";
+    }
+}
+
+TEST_F(TestTimeman, TimerThread) {
+    TimerThread timer;
+    std::atomic_bool stop(false);
+
+    auto start = std::chrono::steady_clock::now();
+    timer.arm(start + std::chrono::milliseconds(20), stop);
+    while (!stop)
+        std::this_thread::yield();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_GE(ms, 20.0);
+    EXPECT_LT(ms, 200.0);
+    EXPECT_TRUE(timer.fired());
+
+    stop = false;
+    timer.arm(std::chrono::steady_clock::now() + std::chrono::milliseconds(20), stop);
+    timer.cancel();
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    EXPECT_FALSE(stop);
+    EXPECT_FALSE(timer.fired());
+
+    // re-arming replaces the pending deadline
+    timer.arm(std::chrono::steady_clock::now() + std::chrono::seconds(10), stop);
+    timer.arm(std::chrono::steady_clock::now() + std::chrono::milliseconds(5), stop);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_TRUE(stop);
+}
+
+// A search that could go on for a long time returns at movetime
+TEST_F(TestTimeman, SearchStopsOnTime) {
+    struct Pos { uint64_t key = 0; };
+    static const SyntheticTree tree;
+    hash_table table;
+    table.resize(16);
+    Search::SearchPool<Pos> pool;
+    pool.init(2, table);
+
+    limits l;
+    std::memset(&l, 0, sizeof(l));
+    l.movetime = 130;
+    Time::Manager tm;
+    tm.init(l, Color::WHITE, 0);
+
+    auto start = std::chrono::steady_clock::now();
+    Search::Result r = pool.search(Pos{0x77ULL}, 60, [](Search::ThreadData<Pos> &td, int depth, const std::atomic_bool &stop) {
+        uint64_t nodes = 0;
+        auto res = tree.root(td.tt, td.pos.key, depth, int(td.id), nodes, stop);
+        td.nodes += nodes;
+        return res;
+    }, &tm);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_GE(ms, 90.0);
+    EXPECT_LT(ms, 250.0);
+    EXPECT_GT(r.depth, 3);
+    std::cout << "[Benchmark] movetime 130: returned after " << ms << " ms at depth " << r.depth << "\n";
+}
+
+namespace {
+    struct PonderPos { uint64_t key = 0; };
+    const SyntheticTree ponder_tree;
+
+    auto ponder_iterate = [](Search::ThreadData<PonderPos> &td, int depth, const std::atomic_bool &stop) {
+        uint64_t nodes = 0;
+        auto res = ponder_tree.root(td.tt, td.pos.key, depth, int(td.id), nodes, stop);
+        td.nodes += nodes;
+        return res;
+    };
+}
+
+// A ponder search ignores its deadlines and keeps its result until ponderhit;
+// having already thought for longer than the move is worth, it then stops at once.
+TEST_F(TestTimeman, PonderhitAfterLongPonder) {
+    hash_table table;
+    table.resize(16);
+    Search::SearchPool<PonderPos> pool;
+    pool.init(2, table);
+
+    limits l;
+    std::memset(&l, 0, sizeof(l));
+    l.movetime = 40;
+    l.ponder = true;
+    Time::Manager tm;
+    tm.init(l, Color::WHITE, 0);
+
+    pool.set_ponder(true);
+    std::atomic_bool returned(false);
+    Search::Result r;
+    std::thread search([&] {
+        r = pool.search(PonderPos{0x99ULL}, 5, ponder_iterate, &tm);
+        returned = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    EXPECT_FALSE(returned); // well past the hard limit and the depth is done
+    EXPECT_TRUE(pool.pondering());
+
+    auto hit = std::chrono::steady_clock::now();
+    pool.ponderhit();
+    search.join();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - hit).count();
+    EXPECT_LT(ms, 20.0);
+    EXPECT_EQ(r.depth, 5);
+    EXPECT_FALSE(pool.pondering());
+}
+
+// An early ponderhit switches to timed search without restarting: the clock
+// starts at the ponderhit and the iterations already done are kept.
+TEST_F(TestTimeman, PonderhitContinuesSearch) {
+    hash_table table;
+    table.resize(16);
+    Search::SearchPool<PonderPos> pool;
+    pool.init(2, table);
+
+    limits l;
+    std::memset(&l, 0, sizeof(l));
+    l.movetime = 130;
+    l.ponder = true;
+    Time::Manager tm;
+    tm.init(l, Color::WHITE, 0);
+
+    std::atomic<int> iterations(0); // completed by the main thread
+    pool.set_ponder(true);
+    Search::Result r;
+    std::thread search([&] {
+        r = pool.search(PonderPos{0x77ULL}, 60, [&](Search::ThreadData<PonderPos> &td, int depth, const std::atomic_bool &stop) {
+            auto res = ponder_iterate(td, depth, stop);
+            if (td.id == 0 && !stop)
+                ++iterations;
+            return res;
+        }, &tm);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    const int before = iterations;
+
+    auto hit = std::chrono::steady_clock::now();
+    pool.ponderhit();
+    search.join();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - hit).count();
+    EXPECT_GE(ms, 60.0);
+    EXPECT_LT(ms, 250.0);
+    EXPECT_GE(r.depth, before);
+    EXPECT_GE(pool[0].completed_depth, before);
+    std::cout << "[Benchmark] ponderhit after 60 ms: " << before << " iterations pondered, returned " << ms
+              << " ms later at depth " << r.depth << "\n";
+}
+
+// stop ends pondering as well, e.g. after a ponder miss
+TEST_F(TestTimeman, StopWhilePondering) {
+    hash_table table;
+    table.resize(16);
+    Search::SearchPool<PonderPos> pool;
+    pool.init(2, table);
+
+    pool.set_ponder(true);
+    std::thread search([&] { pool.search(PonderPos{0x55ULL}, 4, ponder_iterate); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    auto stop = std::chrono::steady_clock::now();
+    pool.stop();
+    search.join();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - stop).count();
+    EXPECT_LT(ms, 20.0);
+    EXPECT_FALSE(pool.pondering());
+}